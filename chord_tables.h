@@ -0,0 +1,33 @@
+/* Generated by gen_tables.py from chords.def; do not edit. */
+
+#pragma once
+
+#define CHORD_COUNT 3
+
+static const uint16_t chord_keycodes[CHORD_COUNT] PROGMEM = {
+    KC_ESC,
+    KC_TAB,
+    KC_ENT,
+};
+
+// Grid indexes (row * 12 + column) of each chord's keys.
+static const uint8_t chord_keys[CHORD_COUNT][2] PROGMEM = {
+    {31, 32},
+    {27, 28},
+    {43, 44},
+};
+
+// Bit per column of each grid row set for keys that belong to a chord.
+static const uint16_t chord_member_rows[5] PROGMEM = {0x000, 0x000, 0x198, 0x180, 0x000};
+
+// Chords containing grid key k are chord_by_key[chord_by_key_start[k]..chord_by_key_start[k + 1]).
+static const uint8_t chord_by_key_start[61] PROGMEM = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 5, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6,
+};
+
+static const uint8_t chord_by_key[] PROGMEM = {1, 1, 0, 0, 2, 2};
@@ -17,18 +17,51 @@
 #pragma once
 
 #ifdef AUDIO_ENABLE
-#    define STARTUP_SONG SONG(PREONIC_SOUND)
-// #define STARTUP_SONG SONG(NO_SOUND)
+/* The Preonic sound is played by the keymap once USB is up, BOOT_SONG_DELAY
+   ms after enumeration, so QMK's own startup song is silent. */
+#    define STARTUP_SONG SONG(NO_SOUND)
+#    define BOOT_SONG_DELAY 250
 
 #    define DEFAULT_LAYER_SONGS \
         { SONG(QWERTY_SOUND), SONG(COLEMAK_SOUND), SONG(DVORAK_SOUND) }
 #endif
 
-// Enables delay during startup song to accomidate for USB startup issues.
-#define AUDIO_INIT_DELAY
-
 #define MUSIC_MASK (keycode != KC_NO)
 
+/* Muse tempo in BPM, adjustable with the encoder within MIN..MAX. Each beat is
+   MUSE_STEPS_PER_BEAT sequencer steps. The encoder with RAISE held moves the
+   base note within MUSE_OFFSET_MIN..MAX, with LOWER the note density (0..MAX,
+   notes scale linearly from none), with both the scale and with Shift the
+   octaves the upper voices spread over. MUSE_OFFSET_MAX leaves room above it for the
+   chime's octave, MUSE_SPREAD_MAX more and the widest scale, so no note goes
+   past MIDI 127. */
+#define MUSE_TEMPO_DEFAULT 150
+#define MUSE_TEMPO_MIN 30
+#define MUSE_TEMPO_MAX 300
+#define MUSE_STEPS_PER_BEAT 4
+#define MUSE_OFFSET_DEFAULT 60
+#define MUSE_OFFSET_MIN 24
+#define MUSE_OFFSET_MAX 64
+#define MUSE_DENSITY_DEFAULT 4
+#define MUSE_DENSITY_MAX 8
+#define MUSE_SPREAD_DEFAULT 1
+#define MUSE_SPREAD_MAX 3
+
+/* Encoder detents are applied once per ENCODER_FLUSH_INTERVAL ms. Detents
+   less than NAV_REPEAT_RATE ms apart count NAV_REPEAT_RATE / gap times, up
+   to the gap NAV_REPEAT_FLOOR below. At most ENCODER_PAGES_MAX PgUp/PgDn
+   taps are kept pending. */
+#define ENCODER_FLUSH_INTERVAL 1
+#define ENCODER_PAGES_MAX 32
+
+/* Arrows, Home/End and PgUp/PgDn repeat in firmware: after NAV_REPEAT_DELAY
+   ms, then every NAV_REPEAT_RATE ms, each interval NAV_REPEAT_DECAY percent
+   of the last, down to NAV_REPEAT_FLOOR ms. */
+#define NAV_REPEAT_DELAY 250
+#define NAV_REPEAT_RATE 60
+#define NAV_REPEAT_DECAY 85
+#define NAV_REPEAT_FLOOR 15
+
 /*
  * MIDI options
  */
@@ -51,9 +84,61 @@
 //#define MIDI_TONE_KEYCODE_OCTAVES 2
 
 #define TAPPING_TERM 250
+#define TAPPING_TERM_PER_KEY
+
+/* Home-row mods learn their own tapping term, see get_tapping_term. The term
+   is the mean tap duration plus HRM_TERM_DEVS mean deviations, at least
+   HRM_TERM_MIN ms and at most the (DT_UP/DT_DOWN adjustable) global term. */
+#define HRM_TERM_MIN 120
+#define HRM_TERM_DEVS 3
+#define HRM_TERM_BUMP 10
+#define HRM_TERM_SAVE_INTERVAL 60000
+
+/* Settings (tapping term, muse parameters, home-row terms) are kept in
+   SETTINGS_SLOTS rotating copies at the start of the EEPROM user datablock,
+   written SETTINGS_SAVE_DELAY ms after the last change. The heatmap (482
+   bytes) takes the end of the datablock. */
+#define SETTINGS_SLOTS 4
+#define SETTINGS_SAVE_DELAY 3000
+#define EECONFIG_USER_DATA_SIZE 600
+
+/* A home-row mod pressed within STREAK_TERM ms of the previous letter is
+   typed as its letter straight away, with no hold decision. */
+#define STREAK_TERM 150
+
+/* Both keys of a chord (chords.def) must go down within CHORD_TERM ms. */
+#define CHORD_TERM 40
+
+/* TD_GRV and TD_QUOT type their single-tap character on press and correct it
+   in place on further taps, instead of waiting out TAPPING_TERM. */
+#define TAP_DANCE_EAGER
 
 #define LEADER_PER_KEY_TIMING
 #define LEADER_TIMEOUT (TAPPING_TERM+50)
 
 #define ONESHOT_TAP_TOGGLE 2  /* Tapping this number of times holds the key until tapped once again. */
-#define ONESHOT_TIMEOUT 5000  /* Time (in ms) before the one shot key is released */
\ No newline at end of file
+#define ONESHOT_TIMEOUT 5000  /* Time (in ms) before the one shot key is released */
+
+/* MACKEY macros are queued and typed by a scheduled task, one character
+   every MACRO_CHAR_DELAY ms. At most MACRO_QUEUE_DEPTH can be pending. */
+#define MACRO_QUEUE_DEPTH 4
+#define MACRO_CHAR_DELAY 10
+
+/* With debug on (DB_TOGG), print scan rate and key latency statistics to the
+   console this often, in ms. */
+#define INSTR_REPORT_INTERVAL 5000
+
+/* Deferred callbacks the keymap can have pending at once (scheduler.c). */
+#define SCHEDULER_CAPACITY 10
+
+/* Key events kept for DB_DUMP, four bytes each. */
+#define TRACE_BUFFER_SIZE 256
+
+/* Custom debounce (debounce_adaptive.c): presses register on the first scan,
+   releases after the contacts stay open for the key's settle window. Windows
+   start at DEBOUNCE ms and adapt to each switch within MIN..MAX, shrinking
+   after DEBOUNCE_SHRINK_CYCLES clean presses. */
+#define DEBOUNCE 5
+#define DEBOUNCE_WINDOW_MIN 2
+#define DEBOUNCE_WINDOW_MAX 20
+#define DEBOUNCE_SHRINK_CYCLES 64
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Per-key asymmetric debounce (DEBOUNCE_TYPE = custom).
+ *
+ * A press is registered on the first scan that sees it, then the key
+ * ignores its contacts for its settle window. A release is only registered
+ * once the contacts have stayed open for a whole window, so a bounce on
+ * release restarts the wait instead of typing the key twice.
+ *
+ * Each key starts with a DEBOUNCE ms window. A bounce in the last quarter of
+ * the press window, or a release that turns out to be a bounce, grows it by
+ * 1 ms up to DEBOUNCE_WINDOW_MAX. After DEBOUNCE_SHRINK_CYCLES clean
+ * presses in a row it shrinks by 1 ms down to DEBOUNCE_WINDOW_MIN, so a
+ * worn switch gets a longer window and a clean one keeps a short one.
+ */
+
+#include "debounce.h"
+#include "matrix.h"
+#include "print.h"
+#include "timer.h"
+#include "debounce_adaptive.h"
+
+#ifndef DEBOUNCE
+#    define DEBOUNCE 5
+#endif
+
+#define DEBOUNCE_RELEASING 0x01 // window is a pending release, not a press lockout
+#define DEBOUNCE_LATE 0x02      // this press bounced late in its window
+
+typedef struct {
+    uint8_t countdown; // ms left in the window, 0 when settled
+    uint8_t window;
+    uint8_t clean;     // clean presses since the window last changed
+    uint8_t flags;
+    uint8_t bounces;   // contact changes ignored inside a window, saturating
+    uint8_t chatter; // releases withdrawn because the contacts closed again, saturating
+} debounce_key_t;
+
+static debounce_key_t debounce_keys[MATRIX_ROWS][MATRIX_COLS];
+static matrix_row_t   debounce_raw[MATRIX_ROWS];
+static uint16_t       debounce_last;
+static bool           debounce_counting = false;
+
+void debounce_init(uint8_t num_rows) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        debounce_raw[row] = 0;
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            debounce_keys[row][col] = (debounce_key_t){.window = DEBOUNCE};
+        }
+    }
+    debounce_last = timer_read();
+}
+
+void debounce_free(void) {}
+
+static void debounce_grow(debounce_key_t *key) {
+    if (key->window < DEBOUNCE_WINDOW_MAX) {
+        key->window++;
+    }
+    key->clean = 0;
+}
+
+static void debounce_released(debounce_key_t *key) {
+    if (key->flags & DEBOUNCE_LATE) {
+        debounce_grow(key);
+    } else if (++key->clean >= DEBOUNCE_SHRINK_CYCLES) {
+        if (key->window > DEBOUNCE_WINDOW_MIN) {
+            key->window--;
+        }
+        key->clean = 0;
+    }
+    key->flags = 0;
+}
+
+static void debounce_count(uint8_t *counter) {
+    if (*counter < UINT8_MAX) {
+        (*counter)++;
+    }
+}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed) {
+    uint16_t elapsed = timer_elapsed(debounce_last);
+    debounce_last += elapsed;
+    if (!changed && !debounce_counting) {
+        return false;
+    }
+
+    bool cooked_changed = false;
+    debounce_counting   = false;
+    for (uint8_t row = 0; row < num_rows; row++) {
+        matrix_row_t edges = raw[row] ^ debounce_raw[row];
+        debounce_raw[row]  = raw[row];
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            debounce_key_t *key     = &debounce_keys[row][col];
+            matrix_row_t    mask    = (matrix_row_t)1 << col;
+            bool            closed  = raw[row] & mask;
+            bool            pressed = cooked[row] & mask;
+
+            if (key->countdown) {
+                if (edges & mask) {
+                    debounce_count(&key->bounces);
+                    if (key->flags & DEBOUNCE_RELEASING) {
+                        key->countdown = key->window;
+                    } else if (key->countdown <= key->window / 4 + 1) {
+                        key->flags |= DEBOUNCE_LATE;
+                    }
+                }
+                key->countdown = elapsed < key->countdown ? key->countdown - elapsed : 0;
+                if (key->countdown == 0 && (key->flags & DEBOUNCE_RELEASING)) {
+                    if (closed) {
+                        // The contacts closed again: a bounce, not a release.
+                        debounce_count(&key->chatter);
+                        debounce_grow(key);
+                        key->flags &= ~DEBOUNCE_RELEASING;
+                    } else {
+                        cooked[row] &= ~mask;
+                        cooked_changed = true;
+                        debounce_released(key);
+                    }
+                    continue;
+                }
+            }
+            if (key->countdown == 0 && closed != pressed) {
+                if (closed) {
+                    cooked[row] |= mask;
+                    cooked_changed = true;
+                    key->flags     = 0;
+                } else {
+                    key->flags |= DEBOUNCE_RELEASING;
+                }
+                key->countdown = key->window;
+            }
+            if (key->countdown) {
+                debounce_counting = true;
+            }
+        }
+    }
+    return cooked_changed;
+}
+
+void debounce_dump(void) {
+    uprintf("debounce: row col window bounces chatter\n");
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            debounce_key_t *key = &debounce_keys[row][col];
+            if (key->bounces || key->chatter || key->window != DEBOUNCE) {
+                uprintf("%u %u %u %u %u\n", row, col, key->window, key->bounces, key->chatter);
+            }
+        }
+    }
+}
@@ -0,0 +1,6 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/* Prints each key's settle window and bounce counts to the console. */
+void debounce_dump(void);
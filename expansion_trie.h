@@ -0,0 +1,152 @@
+/* Generated by gen_tables.py from expansions.def; do not edit. */
+
+#pragma once
+
+#define EXPAND_NONE 0xFF
+#define EXPAND_MAX_LENGTH 6
+
+typedef struct {
+    uint8_t  expansion;
+    uint16_t first_edge;
+    uint8_t  edge_count;
+} expand_node_t;
+
+typedef struct {
+    uint8_t  keycode;
+    uint16_t node;
+} expand_edge_t;
+
+static const char expand_string0[] PROGMEM = "Best regards,\n";
+static const char expand_string1[] PROGMEM = "Thank you!";
+static const char expand_string2[] PROGMEM = "Looks good to me.";
+static const char expand_string3[] PROGMEM = "TODO: ";
+static const char expand_string4[] PROGMEM = "FIXME: ";
+static const char expand_string5[] PROGMEM = "#include ";
+static const char expand_string6[] PROGMEM = "pull request";
+static const char expand_string7[] PROGMEM = "ready for review";
+static const char expand_string8[] PROGMEM = "for example";
+static const char expand_string9[] PROGMEM = "that is";
+static const char expand_string10[] PROGMEM = "as far as I know";
+static const char expand_string11[] PROGMEM = "if I remember correctly";
+static const char expand_string12[] PROGMEM = "\\_(o_o)_/";
+
+static const char *const expand_strings[] PROGMEM = {
+    expand_string0,
+    expand_string1,
+    expand_string2,
+    expand_string3,
+    expand_string4,
+    expand_string5,
+    expand_string6,
+    expand_string7,
+    expand_string8,
+    expand_string9,
+    expand_string10,
+    expand_string11,
+    expand_string12,
+};
+
+// Children of the root by the newest key, 0 for none.
+static const uint16_t expand_root[KC_SLSH - KC_A + 1] PROGMEM = {
+    [KC_C - KC_A] = 1,
+    [KC_D - KC_A] = 2,
+    [KC_E - KC_A] = 3,
+    [KC_G - KC_A] = 4,
+    [KC_K - KC_A] = 5,
+    [KC_M - KC_A] = 6,
+    [KC_R - KC_A] = 7,
+    [KC_X - KC_A] = 8,
+    [KC_Y - KC_A] = 9,
+};
+
+// Node n is expand_nodes[n - 1]; node 0, the root, has no row.
+static const expand_node_t expand_nodes[] PROGMEM = {
+    {EXPAND_NONE, 0, 2},
+    {EXPAND_NONE, 2, 1},
+    {EXPAND_NONE, 3, 1},
+    {EXPAND_NONE, 4, 3},
+    {EXPAND_NONE, 7, 1},
+    {EXPAND_NONE, 8, 1},
+    {EXPAND_NONE, 9, 1},
+    {EXPAND_NONE, 10, 1},
+    {EXPAND_NONE, 11, 1},
+    {EXPAND_NONE, 12, 1},
+    {EXPAND_NONE, 13, 1},
+    {EXPAND_NONE, 14, 1},
+    {EXPAND_NONE, 15, 1},
+    {EXPAND_NONE, 16, 1},
+    {EXPAND_NONE, 17, 1},
+    {EXPAND_NONE, 18, 1},
+    {EXPAND_NONE, 19, 1},
+    {EXPAND_NONE, 20, 1},
+    {EXPAND_NONE, 21, 2},
+    {EXPAND_NONE, 23, 1},
+    {EXPAND_NONE, 24, 1},
+    {EXPAND_NONE, 25, 1},
+    {EXPAND_NONE, 26, 1},
+    {3, 27, 0},
+    {9, 27, 0},
+    {8, 27, 0},
+    {EXPAND_NONE, 27, 1},
+    {EXPAND_NONE, 28, 1},
+    {EXPAND_NONE, 29, 1},
+    {EXPAND_NONE, 30, 1},
+    {EXPAND_NONE, 31, 1},
+    {6, 32, 0},
+    {4, 32, 0},
+    {1, 32, 0},
+    {5, 32, 0},
+    {EXPAND_NONE, 32, 1},
+    {0, 33, 0},
+    {EXPAND_NONE, 33, 1},
+    {EXPAND_NONE, 34, 1},
+    {EXPAND_NONE, 35, 1},
+    {7, 36, 0},
+    {11, 36, 0},
+    {EXPAND_NONE, 36, 1},
+    {EXPAND_NONE, 37, 1},
+    {2, 38, 0},
+    {12, 38, 0},
+    {10, 38, 0},
+};
+
+static const expand_edge_t expand_edges[] PROGMEM = {
+    {KC_N, 10},
+    {KC_R, 11},
+    {KC_T, 12},
+    {KC_I, 13},
+    {KC_E, 14},
+    {KC_I, 15},
+    {KC_U, 16},
+    {KC_I, 17},
+    {KC_T, 18},
+    {KC_P, 19},
+    {KC_F, 20},
+    {KC_T, 21},
+    {KC_I, 22},
+    {KC_I, 23},
+    {KC_SCLN, 24},
+    {KC_SCLN, 25},
+    {KC_SCLN, 26},
+    {KC_S, 27},
+    {KC_R, 28},
+    {KC_A, 29},
+    {KC_G, 30},
+    {KC_R, 31},
+    {KC_SCLN, 32},
+    {KC_SCLN, 33},
+    {KC_SCLN, 34},
+    {KC_SCLN, 35},
+    {KC_I, 36},
+    {KC_SCLN, 37},
+    {KC_H, 38},
+    {KC_F, 39},
+    {KC_L, 40},
+    {KC_SCLN, 41},
+    {KC_SCLN, 42},
+    {KC_S, 43},
+    {KC_A, 44},
+    {KC_SCLN, 45},
+    {KC_SCLN, 46},
+    {KC_SCLN, 47},
+};
@@ -0,0 +1,479 @@
+#!/usr/bin/env python3
+"""Generate the PROGMEM tables this keymap builds from declarative sources.
+
+    leader_sequences.def -> leader_trie.h
+    chords.def           -> chord_tables.h
+    expansions.def       -> expansion_trie.h
+    macros.h             -> macros_packed.h (skipped without macros.h)
+
+Run from the keymap directory after editing a source file and commit the
+regenerated header alongside it; the QMK build only compiles the output.
+macros.h is private, so its header is not committed: regenerate it after
+editing the macros. `gen_tables.py --macros SOURCE OUTPUT` packs only the
+given macros file.
+"""
+
+import heapq
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+HEADER = """\
+/* Generated by gen_tables.py from {source}; do not edit. */
+
+#pragma once
+
+"""
+
+
+def split_args(text):
+    """Split a macro argument list on top-level commas."""
+    args, depth, quoted, start = [], 0, False, 0
+    for i, c in enumerate(text):
+        if quoted:
+            if c == '\\':
+                continue
+            if c == '"' and text[i - 1] != '\\':
+                quoted = False
+        elif c == '"':
+            quoted = True
+        elif c == '(':
+            depth += 1
+        elif c == ')':
+            depth -= 1
+        elif c == ',' and depth == 0:
+            args.append(text[start:i].strip())
+            start = i + 1
+    args.append(text[start:].strip())
+    return args
+
+
+def read_calls(path, names):
+    """Yield (name, args) for each NAME(...) line of a .def file."""
+    pattern = re.compile(r'^\s*(%s)\((.*?)\)\s*(?://.*)?$' % '|'.join(names))
+    with open(path) as f:
+        for line in f:
+            m = pattern.match(line)
+            if m:
+                yield m.group(1), split_args(m.group(2))
+
+
+def write(path, text):
+    with open(path, 'w') as f:
+        f.write(text)
+    print('wrote %s' % os.path.relpath(path, HERE))
+
+
+def parse_c_string(expr):
+    """Bytes of a concatenation of C string literals, or None."""
+    out, i = bytearray(), 0
+    escapes = {'n': 10, 't': 9, 'r': 13, '0': 0, '\\': 92, '"': 34, "'": 39, 'a': 7, 'b': 8, 'f': 12, 'v': 11, 'e': 27}
+    while i < len(expr):
+        c = expr[i]
+        if c.isspace():
+            i += 1
+            continue
+        if c != '"':
+            return None
+        i += 1
+        while expr[i] != '"':
+            c = expr[i]
+            if c != '\\':
+                out += c.encode()
+                i += 1
+                continue
+            e = expr[i + 1]
+            if e == 'x':
+                m = re.match(r'[0-9a-fA-F]+', expr[i + 2:])
+                out.append(int(m.group(0), 16) & 0xFF)
+                i += 2 + len(m.group(0))
+            elif e in '01234567':
+                m = re.match(r'[0-7]{1,3}', expr[i + 1:])
+                out.append(int(m.group(0), 8) & 0xFF)
+                i += 1 + len(m.group(0))
+            else:
+                out.append(escapes[e])
+                i += 2
+        i += 1
+    return bytes(out)
+
+
+# Leader sequences
+
+
+def gen_leader():
+    source = 'leader_sequences.def'
+    strings, sequences = [], []
+    for name, args in read_calls(os.path.join(HERE, source), ['LEADER_TAP', 'LEADER_STRING']):
+        if name == 'LEADER_TAP':
+            action = args[0]
+        else:
+            action = 'LEADER_ACTION_STRING(%d)' % len(strings)
+            strings.append(args[0])
+        sequences.append((tuple(args[1:]), action))
+
+    # Build the trie breadth-first so each node's edges are contiguous.
+    root = {'edges': {}, 'action': None}
+    for keys, action in sequences:
+        node = root
+        for key in keys:
+            node = node['edges'].setdefault(key, {'edges': {}, 'action': None})
+        if node['action'] is not None:
+            sys.exit('%s: duplicate sequence %s' % (source, ', '.join(keys)))
+        node['action'] = action
+
+    nodes, queue = [], [root]
+    while queue:
+        node = queue.pop(0)
+        nodes.append(node)
+        queue.extend(node['edges'].values())
+    index = {id(node): i for i, node in enumerate(nodes)}
+    if len(nodes) > 255:
+        sys.exit('%s: too many trie nodes (%d)' % (source, len(nodes)))
+
+    edges, node_rows = [], []
+    for node in nodes:
+        first = len(edges)
+        for key, child in node['edges'].items():
+            edges.append('    {%s, %d},' % (key, index[id(child)]))
+        node_rows.append('    {%s, %d, %d},' % (node['action'] or 'LEADER_ACTION_NONE', first, len(node['edges'])))
+
+    out = HEADER.format(source=source)
+    out += '#define LEADER_ACTION_NONE 0\n'
+    out += '#define LEADER_ACTION_STRING(index) (0x8000 | (index))\n'
+    out += '#define LEADER_ACTION_IS_STRING(action) ((action) & 0x8000)\n\n'
+    out += 'typedef struct {\n    uint16_t action;\n    uint8_t  first_edge;\n    uint8_t  edge_count;\n} leader_node_t;\n\n'
+    out += 'typedef struct {\n    uint16_t keycode;\n    uint8_t  node;\n} leader_edge_t;\n\n'
+    for i, text in enumerate(strings):
+        out += 'static const char leader_string%d[] PROGMEM = %s;\n' % (i, text)
+    out += '\nstatic const char *const leader_strings[] PROGMEM = {\n'
+    out += ''.join('    leader_string%d,\n' % i for i in range(len(strings)))
+    out += '};\n\n'
+    out += '// Node 0 is the root.\nstatic const leader_node_t leader_nodes[] PROGMEM = {\n'
+    out += '\n'.join(node_rows) + '\n};\n\n'
+    out += 'static const leader_edge_t leader_edges[] PROGMEM = {\n'
+    out += '\n'.join(edges) + '\n};\n'
+    write(os.path.join(HERE, 'leader_trie.h'), out)
+
+
+# Chords
+
+GRID_ROWS, GRID_COLS = 5, 12
+
+
+def grid_index(name, source):
+    m = re.match(r'^k([0-4])([0-9a-b])$', name)
+    if not m:
+        sys.exit('%s: bad key %s' % (source, name))
+    return int(m.group(1)) * GRID_COLS + int(m.group(2), 16)
+
+
+def gen_chords():
+    source = 'chords.def'
+    chords = []
+    for _, args in read_calls(os.path.join(HERE, source), ['CHORD']):
+        keys = sorted(grid_index(key, source) for key in args[1:])
+        if len(keys) != 2 or keys[0] == keys[1]:
+            sys.exit('%s: chords take two distinct keys: %s' % (source, ', '.join(args)))
+        chords.append((args[0], keys))
+    if len(chords) > 255:
+        sys.exit('%s: too many chords (%d)' % (source, len(chords)))
+
+    rows = [0] * GRID_ROWS
+    by_key = [[] for _ in range(GRID_ROWS * GRID_COLS)]
+    for i, (_, keys) in enumerate(chords):
+        for key in keys:
+            rows[key // GRID_COLS] |= 1 << (key % GRID_COLS)
+            by_key[key].append(i)
+    starts, flat = [], []
+    for ids in by_key:
+        starts.append(len(flat))
+        flat.extend(ids)
+    starts.append(len(flat))
+
+    out = HEADER.format(source=source)
+    out += '#define CHORD_COUNT %d\n\n' % len(chords)
+    out += 'static const uint16_t chord_keycodes[CHORD_COUNT] PROGMEM = {\n'
+    out += ''.join('    %s,\n' % keycode for keycode, _ in chords)
+    out += '};\n\n'
+    out += '// Grid indexes (row * 12 + column) of each chord\'s keys.\n'
+    out += 'static const uint8_t chord_keys[CHORD_COUNT][2] PROGMEM = {\n'
+    out += ''.join('    {%d, %d},\n' % tuple(keys) for _, keys in chords)
+    out += '};\n\n'
+    out += '// Bit per column of each grid row set for keys that belong to a chord.\n'
+    out += 'static const uint16_t chord_member_rows[%d] PROGMEM = {%s};\n\n' % (GRID_ROWS, ', '.join('0x%03X' % r for r in rows))
+    out += '// Chords containing grid key k are chord_by_key[chord_by_key_start[k]..chord_by_key_start[k + 1]).\n'
+    out += 'static const uint8_t chord_by_key_start[%d] PROGMEM = {\n' % len(starts)
+    for i in range(0, len(starts), GRID_COLS):
+        out += '    ' + ' '.join('%d,' % n for n in starts[i:i + GRID_COLS]) + '\n'
+    out += '};\n\n'
+    out += 'static const uint8_t chord_by_key[] PROGMEM = {%s};\n' % ', '.join(str(i) for i in flat)
+    write(os.path.join(HERE, 'chord_tables.h'), out)
+
+
+# Text expansion
+
+# Characters an abbreviation may use, with their keycodes and values.
+EXPAND_KEYS = dict(
+    [(chr(ord('a') + i), ('KC_%s' % chr(ord('A') + i), 0x04 + i)) for i in range(26)]
+    + [(str((i + 1) % 10), ('KC_%d' % ((i + 1) % 10), 0x1E + i)) for i in range(10)]
+    + [(' ', ('KC_SPC', 0x2C)), ('-', ('KC_MINS', 0x2D)), ('=', ('KC_EQL', 0x2E)), ('[', ('KC_LBRC', 0x2F)),
+       (']', ('KC_RBRC', 0x30)), ('\\', ('KC_BSLS', 0x31)), (';', ('KC_SCLN', 0x33)), ("'", ('KC_QUOT', 0x34)),
+       ('`', ('KC_GRV', 0x35)), (',', ('KC_COMM', 0x36)), ('.', ('KC_DOT', 0x37)), ('/', ('KC_SLSH', 0x38))]
+)
+
+
+def expand_edges(node):
+    """A node's edges in keycode order, so the keymap can stop scanning early."""
+    return sorted(node['edges'].items(), key=lambda edge: EXPAND_KEYS[edge[0]][1])
+
+
+def gen_expansions():
+    source = 'expansions.def'
+    expansions = []
+    for _, args in read_calls(os.path.join(HERE, source), ['EXPAND']):
+        text = parse_c_string(args[0])
+        abbrev = text.decode().lower() if text else ''
+        if not abbrev or any(c not in EXPAND_KEYS for c in abbrev):
+            sys.exit('%s: abbreviations are unshifted plain characters: %s' % (source, args[0]))
+        expansions.append((abbrev, args[1]))
+    if len(expansions) >= 0xFF:
+        sys.exit('%s: too many expansions (%d)' % (source, len(expansions)))
+
+    # The trie is keyed on abbreviations reversed, so the keymap walks it
+    # backwards from the newest key in its buffer.
+    root = {'edges': {}, 'expansion': None}
+    for i, (abbrev, _) in enumerate(expansions):
+        node = root
+        for c in reversed(abbrev):
+            node = node['edges'].setdefault(c, {'edges': {}, 'expansion': None})
+        if node['expansion'] is not None:
+            sys.exit('%s: duplicate abbreviation %s' % (source, abbrev))
+        node['expansion'] = i
+
+    nodes, queue = [], [root]
+    while queue:
+        node = queue.pop(0)
+        nodes.append(node)
+        queue.extend(child for _, child in expand_edges(node))
+    index = {id(node): i for i, node in enumerate(nodes)}
+    if len(nodes) > 0xFFFF:
+        sys.exit('%s: too many trie nodes (%d)' % (source, len(nodes)))
+
+    # The root's edges are a dense table by keycode; the other nodes list theirs.
+    edges, node_rows = [], []
+    for node in nodes[1:]:
+        first = len(edges)
+        for c, child in expand_edges(node):
+            edges.append('    {%s, %d},' % (EXPAND_KEYS[c][0], index[id(child)]))
+        expansion = 'EXPAND_NONE' if node['expansion'] is None else str(node['expansion'])
+        node_rows.append('    {%s, %d, %d},' % (expansion, first, len(node['edges'])))
+
+    out = HEADER.format(source=source)
+    out += '#define EXPAND_NONE 0xFF\n'
+    out += '#define EXPAND_MAX_LENGTH %d\n\n' % max((len(abbrev) for abbrev, _ in expansions), default=1)
+    out += 'typedef struct {\n    uint8_t  expansion;\n    uint16_t first_edge;\n    uint8_t  edge_count;\n} expand_node_t;\n\n'
+    out += 'typedef struct {\n    uint8_t  keycode;\n    uint16_t node;\n} expand_edge_t;\n\n'
+    for i, (_, text) in enumerate(expansions):
+        out += 'static const char expand_string%d[] PROGMEM = %s;\n' % (i, text)
+    out += '\nstatic const char *const expand_strings[] PROGMEM = {\n'
+    out += ''.join('    expand_string%d,\n' % i for i in range(len(expansions)))
+    out += '};\n\n'
+    out += '// Children of the root by the newest key, 0 for none.\n'
+    out += 'static const uint16_t expand_root[KC_SLSH - KC_A + 1] PROGMEM = {\n'
+    out += ''.join('    [%s - KC_A] = %d,\n' % (EXPAND_KEYS[c][0], index[id(child)]) for c, child in expand_edges(root))
+    out += '};\n\n'
+    out += '// Node n is expand_nodes[n - 1]; node 0, the root, has no row.\n'
+    out += 'static const expand_node_t expand_nodes[] PROGMEM = {\n'
+    out += '\n'.join(node_rows) + '\n};\n\n'
+    out += 'static const expand_edge_t expand_edges[] PROGMEM = {\n'
+    out += '\n'.join(edges) + '\n};\n'
+    write(os.path.join(HERE, 'expansion_trie.h'), out)
+
+
+# Macro compression
+
+MACRO_COUNT = 6
+MACRO_CODE_MAX_LENGTH = 15
+
+# HID codes of the X_ names SS_TAP, SS_DOWN and SS_UP take.
+MACRO_X_CODES = dict(
+    [(chr(ord('A') + i), 0x04 + i) for i in range(26)]
+    + [(str((i + 1) % 10), 0x1E + i) for i in range(10)]
+    + [('F%d' % (i + 1), 0x3A + i) for i in range(12)]
+    + [(name, code) for names, code in [
+        (('ENTER', 'ENT'), 0x28), (('ESCAPE', 'ESC'), 0x29), (('BACKSPACE', 'BSPC'), 0x2A), (('TAB',), 0x2B),
+        (('SPACE', 'SPC'), 0x2C), (('MINUS', 'MINS'), 0x2D), (('EQUAL', 'EQL'), 0x2E), (('LBRC',), 0x2F),
+        (('RBRC',), 0x30), (('BSLS',), 0x31), (('SCLN',), 0x33), (('QUOT',), 0x34), (('GRV',), 0x35),
+        (('COMM',), 0x36), (('DOT',), 0x37), (('SLSH',), 0x38), (('HOME',), 0x4A), (('PGUP',), 0x4B),
+        (('DELETE', 'DEL'), 0x4C), (('END',), 0x4D), (('PGDN',), 0x4E), (('RIGHT', 'RGHT'), 0x4F),
+        (('LEFT',), 0x50), (('DOWN',), 0x51), (('UP',), 0x52), (('LCTL', 'LCTRL'), 0xE0),
+        (('LSFT', 'LSHIFT'), 0xE1), (('LALT',), 0xE2), (('LGUI', 'LCMD', 'LWIN'), 0xE3),
+        (('RCTL', 'RCTRL'), 0xE4), (('RSFT', 'RSHIFT'), 0xE5), (('RALT',), 0xE6), (('RGUI', 'RCMD', 'RWIN'), 0xE7),
+    ] for name in names]
+)
+
+MACRO_MODS = {'LCTL': 'LCTL', 'LSFT': 'LSFT', 'LALT': 'LALT', 'LGUI': 'LGUI', 'LCMD': 'LGUI', 'LWIN': 'LGUI',
+              'LOPT': 'LALT', 'RCTL': 'RCTL', 'RSFT': 'RSFT', 'RALT': 'RALT', 'RGUI': 'RGUI', 'ROPT': 'RALT'}
+
+
+def read_macros(path):
+    """The MACRO_STRINGn definitions of a macros header, by n."""
+    with open(path) as f:
+        text = re.sub(r'\\\n', ' ', f.read())
+    text = re.sub(r'/\*.*?\*/|//[^\n]*|("(?:\\.|[^"\\])*")', lambda m: m.group(1) or ' ', text, flags=re.S)
+    return {int(m.group(1)): m.group(2).strip()
+            for m in re.finditer(r'^\s*#\s*define\s+MACRO_STRING(\d+)\s+(.*)$', text, re.M)}
+
+
+def eval_macro(expr):
+    """Bytes a send_string expression of literals and SS_ macros stands for."""
+    out, i = bytearray(), 0
+    while i < len(expr):
+        if expr[i].isspace():
+            i += 1
+            continue
+        if expr[i] == '"':
+            m = re.match(r'"(?:\\.|[^"\\])*"', expr[i:])
+            if not m:
+                raise ValueError('unterminated string')
+            out += parse_c_string(m.group(0))
+            i += len(m.group(0))
+            continue
+        m = re.match(r'SS_(\w+)\s*\(', expr[i:])
+        if not m:
+            raise ValueError('cannot evaluate %s' % expr[i:].split()[0])
+        start = i + len(m.group(0))
+        depth, quoted, j = 1, False, start
+        while depth:
+            if j == len(expr):
+                raise ValueError('unbalanced SS_%s(' % m.group(1))
+            c = expr[j]
+            if quoted:
+                if c == '\\':
+                    j += 1
+                elif c == '"':
+                    quoted = False
+            elif c == '"':
+                quoted = True
+            elif c in '()':
+                depth += 1 if c == '(' else -1
+            j += 1
+        out += eval_ss(m.group(1), expr[start:j - 1].strip())
+        i = j
+    return bytes(out)
+
+
+def eval_ss(name, arg):
+    def key(arg):
+        code = MACRO_X_CODES.get(arg[2:]) if arg.startswith('X_') else None
+        if code is None:
+            raise ValueError('unknown key %s' % arg)
+        return code
+
+    if name in ('TAP', 'DOWN', 'UP'):
+        return bytes([1, {'TAP': 1, 'DOWN': 2, 'UP': 3}[name], key(arg)])
+    if name == 'DELAY':
+        if not arg.isdigit():
+            raise ValueError('SS_DELAY(%s) is not a number' % arg)
+        return b'\1\4' + arg.encode() + b'|'
+    if name in MACRO_MODS:
+        mod = key('X_' + MACRO_MODS[name])
+        return bytes([1, 2, mod]) + eval_macro(arg) + bytes([1, 3, mod])
+    raise ValueError('unknown macro SS_%s' % name)
+
+
+def huffman_lengths(counts):
+    """Code length per symbol of a Huffman code for the given counts."""
+    if len(counts) == 1:
+        return {symbol: 1 for symbol in counts}
+    heap = [(count, symbol, [symbol]) for symbol, count in counts.items()]
+    heapq.heapify(heap)
+    lengths = dict.fromkeys(counts, 0)
+    while len(heap) > 1:
+        a, b = heapq.heappop(heap), heapq.heappop(heap)
+        for symbol in a[2] + b[2]:
+            lengths[symbol] += 1
+        heapq.heappush(heap, (a[0] + b[0], min(a[1], b[1]), a[2] + b[2]))
+    return lengths
+
+
+def gen_macros(source, output):
+    """Pack the macros with one canonical Huffman code shared by all of them.
+
+    Each string ends in a coded NUL and starts on a byte boundary, so the
+    keymap decodes it in place from flash one character per macro_getc.
+    """
+    name = os.path.basename(source)
+    try:
+        defines = read_macros(source)
+        texts = [eval_macro(defines.get(n, '""')) for n in range(1, MACRO_COUNT + 1)]
+    except ValueError as e:
+        texts, reason = None, str(e)
+    counts = {}
+    for text in texts or []:
+        for b in text + b'\0':
+            counts[b] = counts.get(b, 0) + 1
+    lengths = huffman_lengths(counts) if texts else {}
+    raw = sum(len(text) + 1 for text in texts or [])
+    if texts and max(lengths.values()) > MACRO_CODE_MAX_LENGTH:
+        texts, reason = None, 'codes longer than %d bits' % MACRO_CODE_MAX_LENGTH
+
+    out = HEADER.format(source=name)
+    if texts:
+        symbols = sorted(counts, key=lambda symbol: (lengths[symbol], symbol))
+        max_length = max(lengths.values())
+        per_length = [sum(1 for symbol in symbols if lengths[symbol] == n) for n in range(max_length + 1)]
+        codes, code, length = {}, 0, 0
+        for symbol in symbols:
+            code <<= lengths[symbol] - length
+            length = lengths[symbol]
+            codes[symbol] = code
+            code += 1
+
+        packed, starts = bytearray(), []
+        for text in texts:
+            starts.append(len(packed))
+            bits = ''.join(format(codes[b], '0%db' % lengths[b]) for b in text + b'\0')
+            bits += '0' * (-len(bits) % 8)
+            packed += bytes(int(bits[i:i + 8], 2) for i in range(0, len(bits), 8))
+        size = len(packed) + len(per_length) + len(symbols) + 2 * MACRO_COUNT
+        bits_per_char = sum(lengths[b] for text in texts for b in text + b'\0') / raw
+        if size >= raw:
+            texts, reason = None, 'packing saves nothing (%d bytes to %d)' % (raw, size)
+
+    if not texts:
+        print('%s: left unpacked: %s' % (name, reason))
+        out += '// Left unpacked: %s.\n' % reason
+        write(output, out)
+        return
+
+    print('%s: %d bytes packed into %d (%d%%), %.1f bits per character'
+          % (name, raw, size, 100 * size // raw, bits_per_char))
+    out += '// %d bytes of macros packed into %d, %.1f bits per character.\n' % (raw, size, bits_per_char)
+    for n, text in enumerate(texts, 1):
+        out += ('_Static_assert(sizeof(MACRO_STRING%d) == %d, "%s changed; rerun gen_tables.py");\n'
+                % (n, len(text) + 1, name))
+    out += '\n#define MACRO_PACKED\n'
+    out += '#define MACRO_CODE_MAX_LENGTH %d\n\n' % max_length
+    out += '// Codes of each length, then the symbols in canonical code order.\n'
+    out += 'static const uint8_t macro_code_counts[] PROGMEM = {%s};\n' % ', '.join(map(str, per_length))
+    out += 'static const uint8_t macro_code_symbols[] PROGMEM = {%s};\n\n' % ', '.join('0x%02X' % s for s in symbols)
+    out += 'static const uint16_t macro_packed_start[] PROGMEM = {%s};\n' % ', '.join(map(str, starts))
+    out += 'static const uint8_t macro_packed[] PROGMEM = {\n'
+    out += ''.join('    %s\n' % ' '.join('0x%02X,' % b for b in packed[i:i + 12]) for i in range(0, len(packed), 12))
+    out += '};\n'
+    write(output, out)
+
+
+if __name__ == '__main__':
+    if sys.argv[1:2] == ['--macros']:
+        gen_macros(sys.argv[2], sys.argv[3])
+        sys.exit()
+    gen_leader()
+    gen_chords()
+    gen_expansions()
+    if os.path.exists(os.path.join(HERE, 'macros.h')):
+        gen_macros(os.path.join(HERE, 'macros.h'), os.path.join(HERE, 'macros_packed.h'))
@@ -15,10 +15,27 @@
  */
 
 #include QMK_KEYBOARD_H
-#include "muse.h"
+#include "midi_freq.h"
+#include "leader_trie.h"
+#include "chord_tables.h"
+#include "expansion_trie.h"
+#include "debounce_adaptive.h"
+#include "scheduler.h"
 
-#if __has_include("macros.h")
-#include "macros.h"
+#ifdef PROTOCOL_CHIBIOS
+#    include <ch.h>
+#endif
+
+// macros.h is private; gen_tables.py packs it into MACROS_PACKED_H.
+#ifndef MACROS_H
+#    define MACROS_H "macros.h"
+#    define MACROS_PACKED_H "macros_packed.h"
+#endif
+#if __has_include(MACROS_H)
+#include MACROS_H
+#    if __has_include(MACROS_PACKED_H)
+#        include MACROS_PACKED_H
+#    endif
 #else
 #define MACRO_STRING1 ""
 #define MACRO_STRING2 ""
@@ -28,8 +45,296 @@
 #define MACRO_STRING6 ""
 #endif
 
+/* Ms since an event's timestamp. Events are stamped timer_read() | 1, so a
+   press can read as a ms in the future; that counts as no time at all. */
+static uint16_t event_age(uint16_t time) {
+    int16_t age = timer_elapsed(time);
+    return age < 0 ? 0 : age;
+}
+
+// Instrumentation
+
+/*
+ * Rolling statistics printed to the console every INSTR_REPORT_INTERVAL ms
+ * while debug is on (DB_TOGG): matrix scans per second, the slowest
+ * process_record_user call and muse tick, and per key class a histogram of
+ * the time from the physical press to the key being sent. With debug off
+ * every hook returns after testing debug_enable.
+ */
+#if defined(PROTOCOL_CHIBIOS) && defined(PORT_SUPPORTS_RT) && PORT_SUPPORTS_RT == TRUE
+#    define INSTR_NOW() chSysGetRealtimeCounterX()
+#    define INSTR_UNIT "cycles"
+#else
+#    define INSTR_NOW() timer_read32()
+#    define INSTR_UNIT "ms"
+#endif
+
+enum instr_classes {
+    INSTR_PLAIN,
+    INSTR_HOME_ROW,
+    INSTR_TAP_DANCE,
+    INSTR_CLASSES,
+};
+
+static const char *const instr_class_names[INSTR_CLASSES] = {"plain", "hrm", "dance"};
+
+// Latency buckets: 0, 1, 2-3, 4-7, ..., 128-255 and 256+ ms.
+#define INSTR_BUCKETS 10
+
+static uint16_t instr_latency[INSTR_CLASSES][INSTR_BUCKETS];
+static uint32_t instr_scans;
+static uint32_t instr_worst;
+static uint32_t instr_muse_worst;
+static uint32_t instr_timer;
+static uint16_t instr_dance_pressed;
+static bool     instr_active = false;
+
+static void instr_reset(void) {
+    memset(instr_latency, 0, sizeof(instr_latency));
+    instr_scans = 0;
+    instr_worst = 0;
+    instr_muse_worst = 0;
+    instr_timer = timer_read32();
+}
+
+static void instr_latency_add(uint8_t type, uint16_t pressed) {
+    uint16_t ms     = event_age(pressed);
+    uint8_t  bucket = 0;
+    while (ms && bucket < INSTR_BUCKETS - 1) {
+        ms >>= 1;
+        bucket++;
+    }
+    if (instr_latency[type][bucket] < UINT16_MAX) {
+        instr_latency[type][bucket]++;
+    }
+}
+
+/* Called where a tap dance actually sends its output. */
+static void instr_dance_output(void) {
+    if (debug_enable) {
+        instr_latency_add(INSTR_TAP_DANCE, instr_dance_pressed);
+    }
+}
+
+static void instr_report(uint32_t elapsed) {
+    uprintf("instr: %lu scans/s, worst record %lu " INSTR_UNIT ", worst muse tick %lu " INSTR_UNIT "\n", (unsigned long)(instr_scans * 1000 / elapsed), (unsigned long)instr_worst, (unsigned long)instr_muse_worst);
+    for (uint8_t type = 0; type < INSTR_CLASSES; type++) {
+        uprintf("lat %s:", instr_class_names[type]);
+        for (uint8_t bucket = 0; bucket < INSTR_BUCKETS; bucket++) {
+            uprintf(" %u", instr_latency[type][bucket]);
+        }
+        uprintf("\n");
+    }
+}
+
+static void instr_task(void) {
+    if (!debug_enable) {
+        instr_active = false;
+        return;
+    }
+    if (!instr_active) {
+        instr_active = true;
+        instr_reset();
+        return;
+    }
+    instr_scans++;
+    uint32_t elapsed = timer_elapsed32(instr_timer);
+    if (elapsed >= INSTR_REPORT_INTERVAL) {
+        instr_report(elapsed);
+        instr_reset();
+    }
+}
+
+// Boot
+
+/*
+ * QMK's startup song is silenced in config.h so audio stays off the boot
+ * path. The Preonic sound is scheduled BOOT_SONG_DELAY ms after USB is first
+ * configured, when the keyboard is already usable, and any key pressed while
+ * it plays stops it. DB_DUMP prints when USB was configured and when the
+ * first key was sent, in ms since the timer started at reset.
+ */
+#ifdef AUDIO_ENABLE
+static float boot_song[][2]    = SONG(PREONIC_SOUND);
+static bool  boot_song_playing = false;
+#endif
+static uint32_t boot_usb_at       = 0; // 0 until USB is configured
+static uint32_t boot_first_key_at = 0; // 0 until a key is sent
+
+#ifdef AUDIO_ENABLE
+#    define BOOT_SONG_POLL 100
+
+// Starts the song, then checks every BOOT_SONG_POLL ms whether it is still playing.
+static uint32_t boot_song_task(uint32_t now, void *arg) {
+    if (!boot_song_playing) {
+        boot_song_playing = true;
+        PLAY_SONG(boot_song);
+    } else if (!is_playing_notes()) {
+        boot_song_playing = false;
+        return 0;
+    }
+    return BOOT_SONG_POLL;
+}
+#endif
+
+void notify_usb_device_state_change_user(enum usb_device_state state) {
+    if (state != USB_DEVICE_STATE_CONFIGURED || boot_usb_at) {
+        return;
+    }
+    boot_usb_at = timer_read32() | 1;
+#ifdef AUDIO_ENABLE
+    scheduler_add(boot_usb_at, BOOT_SONG_DELAY, boot_song_task, NULL);
+#endif
+}
+
+/* Called for every physical press. */
+static void boot_key_pressed(void) {
+#ifdef AUDIO_ENABLE
+    scheduler_cancel(boot_song_task);
+    if (boot_song_playing) {
+        stop_all_notes();
+        boot_song_playing = false;
+    }
+#endif
+}
+
+/* Called once a press has been sent. */
+static void boot_key_sent(void) {
+    if (!boot_first_key_at) {
+        boot_first_key_at = timer_read32() | 1;
+    }
+}
+
+static void boot_dump(void) {
+    uprintf("boot: usb %lu ms, first key %lu ms\n", (unsigned long)boot_usb_at, (unsigned long)boot_first_key_at);
+}
+
+// String output
+
+/*
+ * Types a PROGMEM string in as few reports as it can. Consecutive characters
+ * that share a shift state go down together in one report and up together in
+ * the next, as long as their keycodes ascend, so the host reads them in order
+ * from either a 6KRO array or an NKRO bitmap. Shift is a weak mod that only
+ * changes between batches, riding on the release report. Escapes from
+ * SS_TAP, SS_DOWN, SS_UP and SS_DELAY end the current batch.
+ */
+typedef struct {
+    uint8_t keys[KEYBOARD_REPORT_KEYS];
+    uint8_t count;
+    bool    shifted;
+} string_batch_t;
+
+static void string_batch_flush(string_batch_t *batch, bool shift) {
+    if (!batch->count && shift == batch->shifted) {
+        return;
+    }
+    if (batch->count) {
+        for (uint8_t i = 0; i < batch->count; i++) {
+            add_key(batch->keys[i]);
+        }
+        send_keyboard_report();
+        for (uint8_t i = 0; i < batch->count; i++) {
+            del_key(batch->keys[i]);
+        }
+        batch->count = 0;
+    }
+    if (shift != batch->shifted) {
+        if (shift) {
+            add_weak_mods(MOD_BIT(KC_LSFT));
+        } else {
+            del_weak_mods(MOD_BIT(KC_LSFT));
+        }
+        batch->shifted = shift;
+    }
+    send_keyboard_report();
+}
+
+static bool ascii_is_shifted(uint8_t c) {
+    return pgm_read_byte(&ascii_to_shift_lut[c / 8]) & (0x80 >> (c % 8));
+}
+
+static bool ascii_is_altgr(uint8_t c) {
+    return pgm_read_byte(&ascii_to_altgr_lut[c / 8]) & (0x80 >> (c % 8));
+}
+
+static void send_string_batched_P(const char *str) {
+    string_batch_t batch = {.count = 0, .shifted = false};
+    uint8_t        c;
+    while ((c = pgm_read_byte(str++))) {
+        if (c == SS_QMK_PREFIX) {
+            string_batch_flush(&batch, false);
+            // A string cut short after the prefix or code ends here rather
+            // than reading past its terminator.
+            uint8_t code = pgm_read_byte(str++);
+            if (!code) {
+                break;
+            }
+            if (code == SS_DELAY_CODE) {
+                uint16_t ms = 0;
+                while ((c = pgm_read_byte(str)) >= '0' && c <= '9') {
+                    ms = ms * 10 + (c - '0');
+                    str++;
+                }
+                if (c == '|') {
+                    str++;
+                }
+                wait_ms(ms);
+                continue;
+            }
+            uint8_t keycode = pgm_read_byte(str++);
+            if (!keycode) {
+                break;
+            }
+            if (code == SS_TAP_CODE) {
+                tap_code(keycode);
+            } else if (code == SS_DOWN_CODE) {
+                register_code(keycode);
+            } else if (code == SS_UP_CODE) {
+                unregister_code(keycode);
+            } else {
+                break;
+            }
+            continue;
+        }
+        if (c >= 0x80 || ascii_is_altgr(c)) {
+            string_batch_flush(&batch, false);
+            send_char(c);
+            continue;
+        }
+
+        uint8_t keycode = pgm_read_byte(&ascii_to_keycode_lut[c]);
+        bool    shift   = ascii_is_shifted(c);
+        if (shift != batch.shifted || (batch.count && (batch.count == KEYBOARD_REPORT_KEYS || keycode <= batch.keys[batch.count - 1]))) {
+            string_batch_flush(&batch, shift);
+        }
+        batch.keys[batch.count++] = keycode;
+    }
+    string_batch_flush(&batch, false);
+}
+
+#define SEND_STRING_BATCHED(string) send_string_batched_P(PSTR(string))
+
 // Tap dance
 
+enum tapdance_keycodes {
+    // Dances driven by td_table come first so their id doubles as the row.
+    TD_QUOTES,
+    TD_GRAVE,
+    TD_APP_MAGIC,
+    TD_TABLE_ROWS,
+
+    TD_5_F5 = TD_TABLE_ROWS,
+    TD_7_F7,
+    TD_8_F8,
+    TD_9_F9,
+};
+
+/*
+ * Resolved dance state. The value is 1 + (min(count, 4) - 1) * 2 + hold, so
+ * it can be computed without branching on the count and, minus one, indexes
+ * a td_table row directly. TAP_STATE_RESET means the dance is not active.
+ */
 typedef enum {
     TAP_STATE_RESET,
     SINGLE_TAP,
@@ -42,200 +347,213 @@ typedef enum {
     SUCCESSIVE_HOLD,
 } tap_state_t;
 
-// Global TapDance State
-static struct t_tap {
-    tap_state_t quotes;
-    tap_state_t grave;
-    tap_state_t magic;
-} qk_tap_state = {
-    .quotes = 0,
-    .grave = 0,
-    .magic = 0,
-};
+#define TD_TABLE_COLS (SUCCESSIVE_HOLD - SINGLE_TAP + 1)
+#define TD_COL(state) ((state) - SINGLE_TAP)
+#define TD_IS_HOLD(state) (TD_COL(state) & 1)
 
 /* Sentinel value for invalid tap dance exit */
 #define TAP_DANCE_NO_MATCH 64
 
 tap_state_t get_tapdance_state(tap_dance_state_t *state) {
-    if (state->count == 1) {
-        if (state->interrupted || !state->pressed) {
-            return SINGLE_TAP;
-        } else {
-            return SINGLE_HOLD;
-        }
-    } else if (state->count == 2) {
-        if (state->interrupted || !state->pressed) {
-            return DOUBLE_TAP;
-        } else {
-            return DOUBLE_HOLD;
-        }
-    } else if (state->count == 3) {
-        if (state->interrupted || !state->pressed) {
-            return TRIPLE_TAP;
-        } else {
-            return TRIPLE_HOLD;
-        }
-    } else {
-        if (state->interrupted || !state->pressed) {
-            return SUCCESSIVE_TAP;
-        } else {
-            return SUCCESSIVE_HOLD;
-        }
-    }
+    uint8_t count = state->count > 4 ? 4 : state->count;
+    bool    hold  = state->pressed && !state->interrupted;
+    return (tap_state_t)(SINGLE_TAP + (((count - 1) << 1) | hold));
+}
+
+/*
+ * Table cells. Keycodes are held from the end of the dance until its reset,
+ * mod masks likewise, and strings from td_strings are typed once when the
+ * dance finishes. Basic and shifted keycodes all fit below TDA_MODS.
+ */
+#define TDA_NONE KC_NO
+#define TDA_MODS(mods) (0x4000 | (mods))
+#define TDA_STRING(str) (0x8000 | (str))
+#define TDA_TYPE(action) ((action) & 0xC000)
+#define TDA_ARG(action) ((action) & 0x00FF)
+
+enum tapdance_strings {
+    TDS_FENCE,
+    TDS_HYPER_X,
+    TDS_HYPER_Y,
+    TDS_HYPER_Z,
+};
+
+static const char tds_fence[] PROGMEM   = "```";
+static const char tds_hyper_x[] PROGMEM = SS_LSFT(SS_LCTL(SS_LALT(SS_LGUI("x"))));
+static const char tds_hyper_y[] PROGMEM = SS_LSFT(SS_LCTL(SS_LALT(SS_LGUI("y"))));
+static const char tds_hyper_z[] PROGMEM = SS_LSFT(SS_LCTL(SS_LALT(SS_LGUI("z"))));
+
+static const char *const td_strings[] PROGMEM = {
+    [TDS_FENCE]   = tds_fence,
+    [TDS_HYPER_X] = tds_hyper_x,
+    [TDS_HYPER_Y] = tds_hyper_y,
+    [TDS_HYPER_Z] = tds_hyper_z,
+};
+
+#define TD_CAG_MODS TDA_MODS(MOD_LGUI | MOD_LALT | MOD_LCTL)
+
+// clang-format off
+static const uint16_t PROGMEM td_table[TD_TABLE_ROWS][TD_TABLE_COLS] = {
+    //                single tap / hold                       double tap / hold                       triple tap / hold                       successive tap / hold
+    [TD_QUOTES]    = { KC_QUOTE,                KC_QUOTE,     KC_DOUBLE_QUOTE,         KC_DOUBLE_QUOTE, KC_PIPE,                 KC_PIPE,               KC_QUOTE, KC_QUOTE    },
+    [TD_GRAVE]     = { KC_GRV,                  KC_GRV,       KC_TILDE,                KC_TILDE,        TDA_STRING(TDS_FENCE),   TDA_STRING(TDS_FENCE), KC_GRV,   KC_GRV      },
+    [TD_APP_MAGIC] = { TDA_STRING(TDS_HYPER_X), TD_CAG_MODS,  TDA_STRING(TDS_HYPER_Y), TD_CAG_MODS,     TDA_STRING(TDS_HYPER_Z), TD_CAG_MODS,           TDA_NONE, TD_CAG_MODS },
+};
+// clang-format on
+
+#ifdef TAP_DANCE_EAGER
+/* Rows that type their tap output from on_each_tap; see td_table_each_tap. */
+#    define TD_EAGER_ROWS ((1 << TD_QUOTES) | (1 << TD_GRAVE))
+#endif
+
+// Global TapDance State, one byte per table row
+static uint8_t td_state[TD_TABLE_ROWS];
+
+static uint16_t td_action(uint8_t row, tap_state_t state) {
+    return pgm_read_word(&td_table[row][TD_COL(state)]);
 }
 
-void td_quotes_finished(tap_dance_state_t *state, void *user_data) {
-    qk_tap_state.quotes = get_tapdance_state(state);
-    switch (qk_tap_state.quotes) {
-        case SINGLE_TAP:
-        case SINGLE_HOLD:
-        case SUCCESSIVE_TAP:
-        case SUCCESSIVE_HOLD:
-            register_code16(KC_QUOTE);
+static void td_action_press(uint16_t action) {
+    switch (TDA_TYPE(action)) {
+        case 0:
+            if (action != TDA_NONE) {
+                register_code16(action);
+            }
             break;
-        case DOUBLE_TAP:
-        case DOUBLE_HOLD:
-            register_code16(KC_DOUBLE_QUOTE);
+        case TDA_MODS(0):
+            register_mods(TDA_ARG(action));
             break;
-        case TRIPLE_TAP:
-        case TRIPLE_HOLD:
-            register_code16(KC_PIPE);
         default:
+            send_string_batched_P((const char *)pgm_read_ptr(&td_strings[TDA_ARG(action)]));
             break;
     }
 }
 
-void td_quotes_reset(tap_dance_state_t *state, void *user_data) {
-    switch (qk_tap_state.quotes) {
-        case SINGLE_TAP:
-        case SINGLE_HOLD:
-        case SUCCESSIVE_TAP:
-        case SUCCESSIVE_HOLD:
-            unregister_code16(KC_QUOTE);
-            break;
-        case DOUBLE_TAP:
-        case DOUBLE_HOLD:
-            unregister_code16(KC_DOUBLE_QUOTE);
+static void td_action_release(uint16_t action) {
+    switch (TDA_TYPE(action)) {
+        case 0:
+            if (action != TDA_NONE) {
+                unregister_code16(action);
+            }
             break;
-        case TRIPLE_TAP:
-        case TRIPLE_HOLD:
-            unregister_code16(KC_PIPE);
+        case TDA_MODS(0):
+            unregister_mods(TDA_ARG(action));
             break;
         default:
             break;
     }
-    qk_tap_state.quotes = 0;
 }
 
-void td_grave_finished(tap_dance_state_t *state, void *user_data) {
-    qk_tap_state.grave = get_tapdance_state(state);
-    switch (qk_tap_state.grave) {
-        case SINGLE_TAP:
-        case SINGLE_HOLD:
-        case SUCCESSIVE_TAP:
-        case SUCCESSIVE_HOLD:
-            register_code16(KC_GRV);
-            break;
-        case DOUBLE_TAP:
-        case DOUBLE_HOLD:
-            register_code16(KC_TILDE);
-            break;
-        case TRIPLE_TAP:
-        case TRIPLE_HOLD:
-            SEND_STRING("```");
-            break;
+#ifdef TAP_DANCE_EAGER
+/*
+ * Eager rows whose current dance types as it goes. A dance that starts with
+ * Ctrl, Alt or GUI held waits for its finish like any other, since its
+ * corrections would go out as Ctrl+Backspace and friends.
+ */
+static uint8_t td_eager_live;
+
+/* Number of characters an action types when tapped. */
+static uint8_t td_action_length(uint16_t action) {
+    switch (TDA_TYPE(action)) {
+        case 0:
+            return action != TDA_NONE;
+        case TDA_MODS(0):
+            return 0;
         default:
-            break;
+            return strlen_P((const char *)pgm_read_ptr(&td_strings[TDA_ARG(action)]));
     }
 }
 
-void td_grave_reset(tap_dance_state_t *state, void *user_data) {
-    switch (qk_tap_state.grave) {
-        case SINGLE_TAP:
-        case SINGLE_HOLD:
-        case SUCCESSIVE_TAP:
-        case SUCCESSIVE_HOLD:
-            unregister_code16(KC_GRV);
-            break;
-        case DOUBLE_TAP:
-        case DOUBLE_HOLD:
-            unregister_code16(KC_TILDE);
-            break;
-        case TRIPLE_TAP:
-        case TRIPLE_HOLD:
-            break;
-        default:
-            break;
+static void td_eager_erase(uint16_t action) {
+    for (uint8_t n = td_action_length(action); n > 0; n--) {
+        tap_code(KC_BSPC);
     }
-    qk_tap_state.grave = 0;
 }
 
-void td_magic_finished(tap_dance_state_t *state, void *user_data) {
-    qk_tap_state.magic = get_tapdance_state(state);
-    switch (qk_tap_state.magic) {
-        case SINGLE_TAP: {
-            SEND_STRING(SS_LSFT(SS_LCTL(SS_LALT(SS_LGUI("x"))))); // Hyper-X
-            break;
+static void td_eager_tap(uint16_t action) {
+    if (TDA_TYPE(action) == 0) {
+        if (action != TDA_NONE) {
+            tap_code16(action);
         }
-        case DOUBLE_TAP: {
-            SEND_STRING(SS_LSFT(SS_LCTL(SS_LALT(SS_LGUI("y"))))); // Hyper-Y
-            break;
+    } else {
+        td_action_press(action);
+    }
+}
+
+/*
+ * Eager rows type their tap output as each tap lands instead of waiting for
+ * the dance to finish, and correct it in place on the next tap. Successive
+ * taps past the fourth resolve to the same cell, so they change nothing.
+ */
+void td_table_each_tap(tap_dance_state_t *state, void *user_data) {
+    uint8_t row = (uintptr_t)user_data;
+    if (!(TD_EAGER_ROWS & (1 << row))) {
+        return;
+    }
+    if (state->count == 1) {
+        if (get_mods() & ~MOD_MASK_SHIFT) {
+            td_eager_live &= ~(1 << row);
+        } else {
+            td_eager_live |= 1 << row;
         }
-        case TRIPLE_TAP: {
-            SEND_STRING(SS_LSFT(SS_LCTL(SS_LALT(SS_LGUI("z"))))); // Hyper-Z
-            break;
+    }
+    if (!(td_eager_live & (1 << row)) || state->count > 4) {
+        return;
+    }
+    if (state->count > 1) {
+        td_eager_erase(td_action(row, SINGLE_TAP + ((state->count - 2) << 1)));
+    }
+    td_eager_tap(td_action(row, SINGLE_TAP + ((state->count - 1) << 1)));
+    instr_dance_output();
+}
+#else
+#    define td_table_each_tap NULL
+#endif
+
+void td_table_finished(tap_dance_state_t *state, void *user_data) {
+    uint8_t     row    = (uintptr_t)user_data;
+    tap_state_t state_ = get_tapdance_state(state);
+    uint16_t    action = td_action(row, state_);
+#ifdef TAP_DANCE_EAGER
+    if (td_eager_live & (1 << row)) {
+        // A tap is already on screen. A hold swaps it for the held action so
+        // the host still auto-repeats, unless the hold would type the same.
+        if (!TD_IS_HOLD(state_)) {
+            return;
         }
-        case SINGLE_HOLD:
-        case DOUBLE_HOLD:
-        case TRIPLE_HOLD:
-        case SUCCESSIVE_HOLD:
-            register_mods(MOD_LGUI|MOD_LALT|MOD_LCTL);
-            break;
-        default:
-            break;
+        uint16_t typed = td_action(row, state_ - 1);
+        if (typed == action && TDA_TYPE(action) != 0) {
+            return;
+        }
+        td_eager_erase(typed);
     }
+#endif
+    td_state[row] = state_;
+    td_action_press(action);
+    instr_dance_output();
 }
 
-void td_magic_reset(tap_dance_state_t *state, void *user_data) {
-    switch (qk_tap_state.magic) {
-        case SINGLE_TAP:
-        case DOUBLE_TAP:
-        case TRIPLE_TAP:
-        case SUCCESSIVE_TAP:
-            break;
-        case SINGLE_HOLD:
-        case DOUBLE_HOLD:
-        case TRIPLE_HOLD:
-        case SUCCESSIVE_HOLD:
-            unregister_mods(MOD_LGUI|MOD_LALT|MOD_LCTL);
-            break;
-        default:
-            break;
+void td_table_reset(tap_dance_state_t *state, void *user_data) {
+    uint8_t row = (uintptr_t)user_data;
+    if (td_state[row] != TAP_STATE_RESET) {
+        td_action_release(td_action(row, td_state[row]));
+        td_state[row] = TAP_STATE_RESET;
     }
-    qk_tap_state.magic = 0;
 }
 
-// Tap Dance Declarations
-enum tapdance_keycodes {
-    TD_QUOTES,
-    TD_GRAVE,
-    TD_APP_MAGIC,
-    TD_5_F5,
-    TD_7_F7,
-    TD_8_F8,
-    TD_9_F9,
-};
+#define ACTION_TAP_DANCE_TABLE(row) \
+    { .fn = {td_table_each_tap, td_table_finished, td_table_reset}, .user_data = (void *)(row) }
 
 // Tap Dance Definitions
 tap_dance_action_t tap_dance_actions[] = {
-    // once: single quote, twice: double quote, thrice: backtick
-    [TD_QUOTES] = ACTION_TAP_DANCE_FN_ADVANCED(NULL, td_quotes_finished, td_quotes_reset),
+    // once: single quote, twice: double quote, thrice: pipe
+    [TD_QUOTES] = ACTION_TAP_DANCE_TABLE(TD_QUOTES),
 
-    // once: `, twice: ~, thrice: `|`
-    [TD_GRAVE] = ACTION_TAP_DANCE_FN_ADVANCED(NULL, td_grave_finished, td_grave_reset),
+    // once: `, twice: ~, thrice: ```
+    [TD_GRAVE] = ACTION_TAP_DANCE_TABLE(TD_GRAVE),
 
-    // once: mute, hold: Ctrl
-    [TD_APP_MAGIC] = ACTION_TAP_DANCE_FN_ADVANCED(NULL, td_magic_finished, td_magic_reset),
+    // tap: Hyper-X/Y/Z, hold: Ctrl+Alt+Gui
+    [TD_APP_MAGIC] = ACTION_TAP_DANCE_TABLE(TD_APP_MAGIC),
 
     [TD_5_F5] = ACTION_TAP_DANCE_DOUBLE(KC_5, KC_F5),
     [TD_7_F7] = ACTION_TAP_DANCE_DOUBLE(KC_7, KC_F7),
@@ -263,81 +581,387 @@ tap_dance_action_t tap_dance_actions[] = {
 #define HOME_L LALT_T(KC_L)
 #define HOME_SCLN RCTL_T(KC_SCLN)
 
-// Layers
+/* Index of a home-row mod in hrm_terms, or -1. */
+static int8_t home_row_index(uint16_t keycode) {
+    switch (keycode) {
+        case HOME_A:
+            return 0;
+        case HOME_S:
+            return 1;
+        case HOME_D:
+            return 2;
+        case HOME_F:
+            return 3;
+        case HOME_J:
+            return 4;
+        case HOME_K:
+            return 5;
+        case HOME_L:
+            return 6;
+        case HOME_SCLN:
+            return 7;
+        default:
+            return -1;
+    }
+}
 
-enum preonic_layers {
-    _QWERTY,
-    _LOWER,
-    _RAISE,
-    _ADJUST,
-};
+static bool is_home_row_mod(uint16_t keycode) {
+    return home_row_index(keycode) >= 0;
+}
 
-enum preonic_keycodes {
-    LOWER = SAFE_RANGE,
-    RAISE,
-    BACKLIT,
-    TRAILING_SEMICOLON,
-    TRAILING_COMMA,
-    RIGHT_ARROW,
-    MACKEY1,
-    MACKEY2,
-    MACKEY3,
-    MACKEY4,
-    MACKEY5,
-    MACKEY6,
-};
+// Adaptive tapping term
 
-#define MT_LSFT MT(MOD_LSFT, KC_MINUS)
-#define MT_RSFT MT(MOD_RSFT, KC_QUOTE)
-#define MT_LCTL MT(MOD_LCTL, KC_LPRN)
-#define MT_LALT MT(MOD_LALT, KC_LBRC)
-#define MT_LGUI MT(MOD_LGUI, KC_LCBR)
+/*
+ * Each home-row mod learns its own tapping term from how long it is held when
+ * it is tapped. The term follows the mean tap duration plus HRM_TERM_DEVS mean
+ * deviations, clamped to HRM_TERM_MIN..g_tapping_term, so DT_UP/DT_DOWN still
+ * set the ceiling. A hold released without any other key pressed meanwhile
+ * was a tap that ran out of time, so it raises the mean by HRM_TERM_BUMP.
+ *
+ * Means and deviations are kept in 1/16 ms and saved with the other settings
+ * in 4 ms units at most once every HRM_TERM_SAVE_INTERVAL.
+ */
+#define HRM_KEYS 8
 
-#define OS_LSFT OSM(MOD_LSFT)
-#define OS_RSFT OSM(MOD_RSFT)
-#define OS_LCTL OSM(MOD_LCTL)
-#define OS_LALT OSM(MOD_LALT)
-#define OS_LGUI OSM(MOD_LGUI)
+static const char hrm_names[HRM_KEYS] = {'a', 's', 'd', 'f', 'j', 'k', 'l', ';'};
 
-#define TR_SCLN TRAILING_SEMICOLON
-#define TR_COMM TRAILING_COMMA
-#define TR_RARR RIGHT_ARROW
+static uint16_t hrm_mean[HRM_KEYS]; // 0 until the key has been tapped
+static uint16_t hrm_dev[HRM_KEYS];
+static uint16_t hrm_pressed_at[HRM_KEYS];
+static uint8_t  hrm_held;    // bit per home-row mod currently down
+static uint8_t  hrm_other;   // ...that saw another key pressed while down
+static bool     hrm_dirty; // stored terms changed since they were last saved
 
-#define CMD_Z LGUI(KC_Z)
-#define CMD_X LGUI(KC_X)
-#define CMD_C LGUI(KC_C)
-#define CMD_V LGUI(KC_V)
-#define HY_TAB HYPR(KC_TAB)
+/* A mean or deviation as the settings store it, in 4 ms units. */
+static uint8_t hrm_stored(uint16_t value) {
+    return (value >> 6) > UINT8_MAX ? UINT8_MAX : value >> 6;
+}
 
-// clang-format off
-const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+/* Sets a key's learned term, marking it for saving only if the stored
+   4 ms values change, so steady typing does not keep rewriting a slot. */
+static void hrm_set(uint8_t index, uint16_t mean, uint16_t dev) {
+    if (hrm_stored(mean) != hrm_stored(hrm_mean[index]) || hrm_stored(dev) != hrm_stored(hrm_dev[index])) {
+        hrm_dirty = true;
+    }
+    hrm_mean[index] = mean;
+    hrm_dev[index]  = dev;
+}
 
-/* QWERTY
- * ┌──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┐
- * │  `   │  1   │  2   │  3   │  4   │  5   │  6   │  7   │  8   │  9   │  0   │ Del  │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │ Tab  │  Q   │  W   │  E   │  R   │  T   │  Y   │  U   │  I   │  O   │  P   │ Bksp │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │ Esc  │  A   │  S   │  D   │  F   │  G   │  H   │  J   │  K   │  L   │  ;   │Enter │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │LShft │  Z   │  X   │  C   │  V   │  B   │  N   │  M   │  ,   │  .   │  /   │RShft │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │ HYPR │ Ctrl │ Alt  │ Gui  │Lower │Space │Space │Raise │ Left │ Down │  Up  │Right │
- * └──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┘
- */
-[_QWERTY] = LAYOUT_preonic_grid(
-    TD_GRV,  KC_1,    KC_2,    KC_3,    KC_4,    KC_5,    KC_6,    KC_7,    KC_8,    KC_9,    KC_0,    KC_DEL,
-    KC_TAB,  KC_Q,    KC_W,    KC_E,    KC_R,    KC_T,    KC_Y,    KC_U,    KC_I,    KC_O,    KC_P,    KC_BSPC,
-    KC_ESC,  HOME_A,  HOME_S,  HOME_D,  HOME_F,  KC_G,    KC_H,    HOME_J,  HOME_K,  HOME_L,  HOME_SCLN, KC_ENT,
-    MT_LSFT, KC_Z,    KC_X,    KC_C,    KC_V,    KC_B,    KC_N,    KC_M,    KC_COMM, KC_DOT,  KC_SLSH, MT_RSFT,
-    KC_HYPR, KC_LCTL, KC_LALT, KC_LGUI, LOWER,   KC_SPC,  KC_SPC,  RAISE,   KC_LEFT, KC_DOWN, KC_UP,   KC_RGHT
-),
+static uint16_t hrm_term(uint8_t index) {
+    if (!hrm_mean[index]) {
+        return g_tapping_term;
+    }
+    uint16_t term = (hrm_mean[index] + HRM_TERM_DEVS * hrm_dev[index]) >> 4;
+    if (term > g_tapping_term) {
+        return g_tapping_term;
+    }
+    return term < HRM_TERM_MIN ? HRM_TERM_MIN : term;
+}
 
-/* LOWER
- * ┌──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┐
- * │  ~   │  !   │  @   │  #   │  $   │  %   │  ^   │  &   │  *   │  (   │  )   │ Del  │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │  ~   │  !   │  @   │  #   │  $   │  %   │  ^   │  &   │  *   │  (   │  )   │ Del  │
+uint16_t get_tapping_term(uint16_t keycode, keyrecord_t *record) {
+    int8_t index = home_row_index(keycode);
+    return index < 0 ? g_tapping_term : hrm_term(index);
+}
+
+static void hrm_sample(uint8_t index, uint16_t duration) {
+    uint16_t x = duration << 4;
+    if (!hrm_mean[index]) {
+        hrm_set(index, x, x >> 2);
+    } else {
+        uint16_t error = x > hrm_mean[index] ? x - hrm_mean[index] : hrm_mean[index] - x;
+        uint16_t mean  = hrm_mean[index] - (hrm_mean[index] >> 3) + (x >> 3);
+        uint16_t dev   = hrm_dev[index] - (hrm_dev[index] >> 3) + (error >> 3);
+        hrm_set(index, mean, dev);
+    }
+}
+
+static void hrm_learn(uint16_t keycode, keyrecord_t *record) {
+    int8_t index = home_row_index(keycode);
+    if (record->event.pressed) {
+        hrm_other |= hrm_held;
+    }
+    if (index < 0) {
+        return;
+    }
+
+    uint8_t bit = 1 << index;
+    if (record->event.pressed) {
+        hrm_pressed_at[index] = record->event.time;
+        hrm_held |= bit;
+        hrm_other &= ~bit;
+        return;
+    }
+    if (!(hrm_held & bit)) {
+        return;
+    }
+    hrm_held &= ~bit;
+    if (record->tap.count) {
+        hrm_sample(index, TIMER_DIFF_16(record->event.time, hrm_pressed_at[index]));
+    } else if (!(hrm_other & bit) && hrm_mean[index] && hrm_mean[index] < g_tapping_term << 4) {
+        hrm_set(index, hrm_mean[index] + (HRM_TERM_BUMP << 4), hrm_dev[index]);
+    }
+}
+
+static void send_u16(uint16_t value) {
+    const char *str = get_u16_str(value, ' ');
+    while (*str == ' ') {
+        str++;
+    }
+    send_string(str);
+}
+
+/* DT_PRNT types the global term followed by each home-row mod's term,
+ * e.g. "250 a180 s175 d190 f160 j160 k185 l180 ;195". */
+static void hrm_print_terms(void) {
+    send_u16(g_tapping_term);
+    for (uint8_t i = 0; i < HRM_KEYS; i++) {
+        send_char(' ');
+        send_char(hrm_names[i]);
+        send_u16(hrm_term(i));
+    }
+}
+
+// Text expansion
+
+/*
+ * Abbreviations live in expansions.def and are compiled into a trie of the
+ * reversed abbreviations in expansion_trie.h by gen_tables.py. Each key
+ * typed is pushed onto a buffer as long as the longest abbreviation, and the
+ * trie is walked back from the newest key. The walk stops at the first key
+ * that no abbreviation ends with, which for ordinary typing is the first or
+ * second step, so the cost per key does not grow with the number of entries.
+ */
+#define EXPAND_CLEAR 0xFF // not a basic keycode; a press that only clears the buffer
+
+static uint8_t expand_buffer[EXPAND_MAX_LENGTH];
+static uint8_t expand_head  = 0; // slot of the next key
+static uint8_t expand_count = 0;
+
+static uint16_t expand_child(uint16_t node, uint8_t keycode) {
+    if (node == 0) {
+        return pgm_read_word(&expand_root[keycode - KC_A]);
+    }
+    uint16_t edge = pgm_read_word(&expand_nodes[node - 1].first_edge);
+    uint16_t last = edge + pgm_read_byte(&expand_nodes[node - 1].edge_count);
+    for (; edge < last; edge++) {
+        uint8_t edge_keycode = pgm_read_byte(&expand_edges[edge].keycode);
+        if (edge_keycode >= keycode) {
+            return edge_keycode == keycode ? pgm_read_word(&expand_edges[edge].node) : 0;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Called with the basic keycode of each key before it is sent. On a match
+ * the abbreviation typed so far is erased and its expansion typed in place
+ * of the final key, and false is returned to swallow that key. Any other
+ * key that types something, EXPAND_CLEAR, or a key pressed with Ctrl, Alt or
+ * GUI held clears the buffer; KC_NO leaves it alone.
+ */
+static bool expand_press(uint8_t keycode) {
+    if (keycode == KC_NO) {
+        return true;
+    }
+    if (keycode == KC_BSPC) {
+        if (expand_count) {
+            expand_count--;
+            expand_head = (expand_head ? expand_head : EXPAND_MAX_LENGTH) - 1;
+        }
+        return true;
+    }
+    if (keycode < KC_A || keycode > KC_SLSH || (get_mods() & ~MOD_MASK_SHIFT) || leader_sequence_active()) {
+        expand_count = 0;
+        return true;
+    }
+    expand_buffer[expand_head] = keycode;
+    expand_head                = (expand_head + 1) % EXPAND_MAX_LENGTH;
+    if (expand_count < EXPAND_MAX_LENGTH) {
+        expand_count++;
+    }
+
+    uint16_t node  = 0;
+    uint8_t  slot  = expand_head;
+    uint8_t  found = EXPAND_NONE, length = 0;
+    for (uint8_t depth = 1; depth <= expand_count; depth++) {
+        slot = (slot ? slot : EXPAND_MAX_LENGTH) - 1;
+        node = expand_child(node, expand_buffer[slot]);
+        if (node == 0) {
+            break;
+        }
+        uint8_t expansion = pgm_read_byte(&expand_nodes[node - 1].expansion);
+        if (expansion != EXPAND_NONE) {
+            found  = expansion;
+            length = depth;
+        }
+    }
+    if (found == EXPAND_NONE) {
+        return true;
+    }
+
+    // Shift only mattered for matching; the expansion is typed as written.
+    uint8_t mods = get_mods();
+    clear_mods();
+    expand_count = 0;
+    for (uint8_t i = 1; i < length; i++) {
+        tap_code(KC_BSPC);
+    }
+    send_string_batched_P((const char *)pgm_read_ptr(&expand_strings[found]));
+    set_mods(mods);
+    return false;
+}
+
+// Typing streaks
+
+/*
+ * While a word is being typed, home-row mods are letters. A HOME_* press that
+ * lands within STREAK_TERM ms of the previous letter is registered as its tap
+ * keycode from pre_process_record_user, before the tapping code can buffer
+ * it, and its release is handled the same way. Holds are only possible after
+ * a pause in typing.
+ *
+ * The streak only counts letters that have already been sent, so a streak
+ * key can never overtake a key still waiting in the tapping buffer.
+ */
+typedef struct {
+    keypos_t key;
+    uint8_t  keycode; // KC_NO when the slot is free
+} streak_key_t;
+
+static streak_key_t streak_keys[HRM_KEYS];
+static uint16_t     streak_last;
+static bool         streak_valid = false;
+
+/* Letters, digits and punctuation; Enter, Esc, Backspace, Tab and Space end
+   the word, so a home-row key right after them can still be held. */
+static bool is_typing_keycode(uint16_t keycode, keyrecord_t *record) {
+    if (IS_QK_MOD_TAP(keycode)) {
+        return is_home_row_mod(keycode) && record->tap.count;
+    }
+    return (keycode >= KC_A && keycode <= KC_0) || (keycode >= KC_MINS && keycode <= KC_SLSH);
+}
+
+/* Tracks sent letters; called from process_record_user. */
+static void streak_note(uint16_t keycode, keyrecord_t *record) {
+    if (record->event.pressed) {
+        streak_valid = is_typing_keycode(keycode, record);
+        streak_last  = record->event.time;
+    }
+}
+
+static bool streak_release(keyrecord_t *record) {
+    for (uint8_t i = 0; i < HRM_KEYS; i++) {
+        if (streak_keys[i].keycode != KC_NO && streak_keys[i].key.row == record->event.key.row && streak_keys[i].key.col == record->event.key.col) {
+            unregister_code(streak_keys[i].keycode);
+            streak_keys[i].keycode = KC_NO;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool streak_press(uint16_t keycode, keyrecord_t *record) {
+    if (!IS_QK_MOD_TAP(keycode)) {
+        return true;
+    }
+    if (!is_home_row_mod(keycode) || !streak_valid || TIMER_DIFF_16(record->event.time, streak_last) >= STREAK_TERM || leader_sequence_active()) {
+        // Anything typed after this waits on the tapping buffer.
+        streak_valid = false;
+        return true;
+    }
+    for (uint8_t i = 0; i < HRM_KEYS; i++) {
+        if (streak_keys[i].keycode == KC_NO) {
+            streak_keys[i].key     = record->event.key;
+            streak_keys[i].keycode = QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
+            if (expand_press(streak_keys[i].keycode)) {
+                register_code(streak_keys[i].keycode);
+            }
+            streak_last = record->event.time;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Layers
+
+enum preonic_layers {
+    _QWERTY,
+    _LOWER,
+    _RAISE,
+    _ADJUST,
+};
+
+enum preonic_keycodes {
+    LOWER = SAFE_RANGE,
+    RAISE,
+    BACKLIT,
+    TRAILING_SEMICOLON,
+    TRAILING_COMMA,
+    RIGHT_ARROW,
+    MACKEY1,
+    MACKEY2,
+    MACKEY3,
+    MACKEY4,
+    MACKEY5,
+    MACKEY6,
+    MACRO_STOP,
+    DEBUG_DUMP,
+};
+
+#define MT_LSFT MT(MOD_LSFT, KC_MINUS)
+#define MT_RSFT MT(MOD_RSFT, KC_QUOTE)
+#define MT_LCTL MT(MOD_LCTL, KC_LPRN)
+#define MT_LALT MT(MOD_LALT, KC_LBRC)
+#define MT_LGUI MT(MOD_LGUI, KC_LCBR)
+
+#define OS_LSFT OSM(MOD_LSFT)
+#define OS_RSFT OSM(MOD_RSFT)
+#define OS_LCTL OSM(MOD_LCTL)
+#define OS_LALT OSM(MOD_LALT)
+#define OS_LGUI OSM(MOD_LGUI)
+
+#define TR_SCLN TRAILING_SEMICOLON
+#define TR_COMM TRAILING_COMMA
+#define TR_RARR RIGHT_ARROW
+#define MC_STOP MACRO_STOP
+#define DB_DUMP DEBUG_DUMP
+
+#define CMD_Z LGUI(KC_Z)
+#define CMD_X LGUI(KC_X)
+#define CMD_C LGUI(KC_C)
+#define CMD_V LGUI(KC_V)
+#define HY_TAB HYPR(KC_TAB)
+
+// clang-format off
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+
+/* QWERTY
+ * ┌──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┐
+ * │  `   │  1   │  2   │  3   │  4   │  5   │  6   │  7   │  8   │  9   │  0   │ Del  │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │ Tab  │  Q   │  W   │  E   │  R   │  T   │  Y   │  U   │  I   │  O   │  P   │ Bksp │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │ Esc  │  A   │  S   │  D   │  F   │  G   │  H   │  J   │  K   │  L   │  ;   │Enter │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │LShft │  Z   │  X   │  C   │  V   │  B   │  N   │  M   │  ,   │  .   │  /   │RShft │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │ HYPR │ Ctrl │ Alt  │ Gui  │Lower │Space │Space │Raise │ Left │ Down │  Up  │Right │
+ * └──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┘
+ */
+[_QWERTY] = LAYOUT_preonic_grid(
+    TD_GRV,  KC_1,    KC_2,    KC_3,    KC_4,    KC_5,    KC_6,    KC_7,    KC_8,    KC_9,    KC_0,    KC_DEL,
+    KC_TAB,  KC_Q,    KC_W,    KC_E,    KC_R,    KC_T,    KC_Y,    KC_U,    KC_I,    KC_O,    KC_P,    KC_BSPC,
+    KC_ESC,  HOME_A,  HOME_S,  HOME_D,  HOME_F,  KC_G,    KC_H,    HOME_J,  HOME_K,  HOME_L,  HOME_SCLN, KC_ENT,
+    MT_LSFT, KC_Z,    KC_X,    KC_C,    KC_V,    KC_B,    KC_N,    KC_M,    KC_COMM, KC_DOT,  KC_SLSH, MT_RSFT,
+    KC_HYPR, KC_LCTL, KC_LALT, KC_LGUI, LOWER,   KC_SPC,  KC_SPC,  RAISE,   KC_LEFT, KC_DOWN, KC_UP,   KC_RGHT
+),
+
+/* LOWER
+ * ┌──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┐
+ * │  ~   │  !   │  @   │  #   │  $   │  %   │  ^   │  &   │  *   │  (   │  )   │ Del  │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │  ~   │  !   │  @   │  #   │  $   │  %   │  ^   │  &   │  *   │  (   │  )   │ Del  │
  * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
  * │ Esc  │      │      │      │      │  (   │  )   │  -   │  +   │  {   │  }   │  ;   │
  * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
@@ -354,70 +978,690 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
     _______, _______, _______, _______, _______, TR_RARR, TR_RARR, _______,    KC_HOME,    KC_PGDN, KC_PGUP, KC_END
 ),
 
-/* RAISE
- * ┌──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┐
- * │      │      │      │      │      │      │      │      │      │      │      │      │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │  `   │  1   │  2   │  3   │  4   │  5   │  6   │  7   │  8   │  9   │  0   │ Del  │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │ Esc  │  F1  │  F2  │  F3  │  F4  │  F5  │  F6  │ Down │  Up  │  [   │  ]   │ PgUp │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │LShft │  F7  │  F8  │  F9  │ F10  │ F11  │ F12  │      │ Home │ End  │  |   │ PgDn │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │      │      │      │      │      │  _   │  _   │      │ Mute │ Vol- │ Vol+ │ Play │
- * └──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┘
+/* RAISE
+ * ┌──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┐
+ * │ Lead │      │      │      │      │      │      │      │      │      │      │      │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │  `   │  1   │  2   │  3   │  4   │  5   │  6   │  7   │  8   │  9   │  0   │ Del  │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │ Esc  │  F1  │  F2  │  F3  │  F4  │  F5  │  F6  │ Down │  Up  │  [   │  ]   │ PgUp │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │LShft │  F7  │  F8  │  F9  │ F10  │ F11  │ F12  │      │ Home │ End  │  |   │ PgDn │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │      │      │      │      │      │  _   │  _   │      │ Mute │ Vol- │ Vol+ │ Play │
+ * └──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┘
+ */
+[_RAISE] = LAYOUT_preonic_grid(
+    QK_LEAD, _______, _______, _______, _______, _______, _______, _______, _______, _______, _______, _______,
+    KC_GRV,  KC_1,    KC_2,    KC_3,    KC_4,    KC_5,    KC_6,    KC_7,    KC_8,    KC_9,    KC_0,    KC_DEL,
+    KC_ESC,  KC_F1,   KC_F2,   KC_F3,   KC_F4,   KC_F5,   KC_F6,   KC_DOWN, KC_UP,   KC_LBRC, KC_RBRC, KC_PGUP,
+    KC_LSFT, KC_F7,   KC_F8,   KC_F9,   KC_F10,  KC_F11,  KC_F12,  _______, KC_HOME, KC_END,  KC_PIPE, KC_PGDN,
+    _______, _______, _______, _______, _______, KC_UNDS, KC_UNDS, _______, KC_MUTE, KC_VOLD, KC_VOLU, KC_MPLY
+),
+
+/* ADJUST
+ * ┌──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┐
+ * │  F1  │  F2  │  F3  │  F4  │  F5  │  F6  │  F7  │  F8  │  F9  │ F10  │ F11  │ F12  │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │      │ BOOT │  DB  │ Dump │      │      │      │      │      │      │      │ Del  │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │      │      │      │ AuOn │AuOff │ AGNr │ AGSw │  M1  │  M2  │  M3  │  M4  │      │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │      │      │      │ MuOn │MuOff │ MiOn │MiOff │  M5  │  M6  │ MStp │      │      │
+ * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
+ * │ Lght │      │      │      │      │      │      │      │      │ DOWN │  UP  │ PRNT │
+ * └──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┘
+ */
+[_ADJUST] = LAYOUT_preonic_grid(
+    KC_F1,   KC_F2,   KC_F3,   KC_F4,   KC_F5,   KC_F6,   KC_F7,   KC_F8,   KC_F9,    KC_F10,  KC_F11,  KC_F12,
+    _______, QK_BOOT, DB_TOGG, DB_DUMP, _______, _______, _______, _______, _______,  _______, _______, KC_DEL,
+    _______, _______, _______,  AU_ON,   AU_OFF,  AG_NORM, AG_SWAP, MACKEY1, MACKEY2, MACKEY3, MACKEY4, _______,
+    _______, _______, _______,  MU_ON,   MU_OFF,  MI_ON,   MI_OFF,  MACKEY5, MACKEY6, MC_STOP, _______, _______,
+    BACKLIT, _______, _______, _______, _______, _______, _______, _______, _______,  DT_DOWN, DT_UP,   DT_PRNT
+)
+
+}; // keymaps
+// clang-format on
+
+// Grid
+
+/*
+ * Position of each matrix key in the 5x12 grid, as row * 12 + column + 1,
+ * with 0 for matrix slots the layout does not use. Built from the layout
+ * macro so it matches whatever matrix the revision wires the grid to.
+ */
+// clang-format off
+static const uint8_t PROGMEM grid_positions[MATRIX_ROWS][MATRIX_COLS] = LAYOUT_preonic_grid(
+     1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12,
+    13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
+    37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48,
+    49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60
+);
+// clang-format on
+
+#define GRID_NONE 0xFF
+
+static uint8_t grid_index(keypos_t key) {
+    if (key.row >= MATRIX_ROWS || key.col >= MATRIX_COLS) {
+        return GRID_NONE;
+    }
+    return pgm_read_byte(&grid_positions[key.row][key.col]) - 1;
+}
+
+// Layer state
+
+/*
+ * LOWER, RAISE and the DIP switch are inputs to one layer-state machine.
+ * Each input change makes a single layer_state_set call, and
+ * layer_state_set_user replaces the layers it owns with the row of
+ * layer_table for the current inputs. The result depends only on which
+ * inputs are active, whatever order they arrived in: LOWER and RAISE
+ * together reach _ADJUST as update_tri_layer did, and the DIP switch holds
+ * _ADJUST on over either of them.
+ */
+#define LAYER_INPUT_LOWER (1 << 0)
+#define LAYER_INPUT_RAISE (1 << 1)
+#define LAYER_INPUT_DIP (1 << 2)
+
+#define LAYER_BIT(layer) (1 << (layer))
+#define LAYER_OWNED (LAYER_BIT(_LOWER) | LAYER_BIT(_RAISE) | LAYER_BIT(_ADJUST))
+
+_Static_assert(_ADJUST < 8, "layer_table rows are one byte");
+
+static const uint8_t layer_table[8] PROGMEM = {
+    [0]                                                       = 0,
+    [LAYER_INPUT_LOWER]                                       = LAYER_BIT(_LOWER),
+    [LAYER_INPUT_RAISE]                                       = LAYER_BIT(_RAISE),
+    [LAYER_INPUT_LOWER | LAYER_INPUT_RAISE]                   = LAYER_BIT(_LOWER) | LAYER_BIT(_RAISE) | LAYER_BIT(_ADJUST),
+    [LAYER_INPUT_DIP]                                         = LAYER_BIT(_ADJUST),
+    [LAYER_INPUT_DIP | LAYER_INPUT_LOWER]                     = LAYER_BIT(_LOWER) | LAYER_BIT(_ADJUST),
+    [LAYER_INPUT_DIP | LAYER_INPUT_RAISE]                     = LAYER_BIT(_RAISE) | LAYER_BIT(_ADJUST),
+    [LAYER_INPUT_DIP | LAYER_INPUT_LOWER | LAYER_INPUT_RAISE] = LAYER_BIT(_LOWER) | LAYER_BIT(_RAISE) | LAYER_BIT(_ADJUST),
+};
+
+static uint8_t layer_inputs = 0;
+
+static void layer_input(uint8_t input, bool active) {
+    uint8_t inputs = active ? layer_inputs | input : layer_inputs & ~input;
+    if (inputs != layer_inputs) {
+        layer_inputs = inputs;
+        layer_state_set(layer_state);
+    }
+}
+
+layer_state_t layer_state_set_user(layer_state_t state) {
+    return (state & ~(layer_state_t)LAYER_OWNED) | pgm_read_byte(&layer_table[layer_inputs]);
+}
+
+// Macros
+
+#ifndef MACRO_PACKED
+static const char macro_string1[] PROGMEM = MACRO_STRING1;
+static const char macro_string2[] PROGMEM = MACRO_STRING2;
+static const char macro_string3[] PROGMEM = MACRO_STRING3;
+static const char macro_string4[] PROGMEM = MACRO_STRING4;
+static const char macro_string5[] PROGMEM = MACRO_STRING5;
+static const char macro_string6[] PROGMEM = MACRO_STRING6;
+
+static const char *const macro_strings[] PROGMEM = {
+    macro_string1, macro_string2, macro_string3, macro_string4, macro_string5, macro_string6,
+};
+#endif
+
+/*
+ * Queued macro sender. MACKEYn only enqueues its macro; macro_task types it
+ * from the scheduler one character per MACRO_CHAR_DELAY ms, so scanning,
+ * the encoder and muse keep running while a long macro is typed.
+ */
+static uint8_t     macro_queue[MACRO_QUEUE_DEPTH];
+static uint8_t     macro_head  = 0;
+static uint8_t     macro_count = 0;
+
+#ifdef MACRO_PACKED
+static const uint8_t *macro_cursor;
+static uint8_t        macro_bit;
+
+static void macro_start(uint8_t index) {
+    macro_cursor = macro_packed + pgm_read_word(&macro_packed_start[index]);
+    macro_bit    = 0x80;
+}
+
+// Decodes the next character straight from flash, one code bit at a time.
+static char macro_getc(void) {
+    uint16_t code = 0, first = 0, index = 0;
+    for (uint8_t length = 1; length <= MACRO_CODE_MAX_LENGTH; length++) {
+        code |= (pgm_read_byte(macro_cursor) & macro_bit) ? 1 : 0;
+        if (!(macro_bit >>= 1)) {
+            macro_cursor++;
+            macro_bit = 0x80;
+        }
+        uint8_t count = pgm_read_byte(&macro_code_counts[length]);
+        if (code - first < count) {
+            return pgm_read_byte(&macro_code_symbols[index + code - first]);
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return '\0';
+}
+#else
+static const char *macro_cursor;
+
+static void macro_start(uint8_t index) {
+    macro_cursor = (const char *)pgm_read_ptr(&macro_strings[index]);
+}
+
+static char macro_getc(void) {
+    return pgm_read_byte(macro_cursor++);
+}
+#endif
+
+// Keys a macro left down with SS_DOWN, released if it is cancelled.
+#define MACRO_HELD_MAX 4
+static uint8_t macro_held[MACRO_HELD_MAX];
+
+static void macro_track_held(uint8_t keycode, bool down) {
+    for (uint8_t i = 0; i < MACRO_HELD_MAX; i++) {
+        if (macro_held[i] == (down ? KC_NO : keycode)) {
+            macro_held[i] = down ? keycode : KC_NO;
+            return;
+        }
+    }
+}
+
+static void macro_next(void) {
+    macro_head = (macro_head + 1) % MACRO_QUEUE_DEPTH;
+    if (--macro_count) {
+        macro_start(macro_queue[macro_head]);
+    }
+}
+
+/* Types one character, returning the delay before the next. */
+static uint32_t macro_task(uint32_t now, void *arg) {
+    if (!macro_count) {
+        return 0;
+    }
+    char c = macro_getc();
+    if (c == '\0') {
+        macro_next();
+        return macro_count ? MACRO_CHAR_DELAY : 0;
+    }
+    if (c != SS_QMK_PREFIX) {
+        send_char(c);
+        return MACRO_CHAR_DELAY;
+    }
+
+    uint8_t code = macro_getc();
+    if (code == SS_DELAY_CODE) {
+        // Digits up to and including the terminating '|'.
+        uint32_t wait = 0;
+        while ((c = macro_getc()) >= '0' && c <= '9') {
+            wait = wait * 10 + (c - '0');
+        }
+        return wait ? wait : 1;
+    }
+
+    uint8_t keycode = macro_getc();
+    switch (code) {
+        case SS_TAP_CODE:
+            tap_code(keycode);
+            break;
+        case SS_DOWN_CODE:
+            register_code(keycode);
+            macro_track_held(keycode, true);
+            break;
+        case SS_UP_CODE:
+            unregister_code(keycode);
+            macro_track_held(keycode, false);
+            break;
+        default:
+            // Truncated escape at the end of a string.
+            macro_next();
+            return macro_count ? MACRO_CHAR_DELAY : 0;
+    }
+    return MACRO_CHAR_DELAY;
+}
+
+static bool macro_enqueue(uint8_t index) {
+    if (macro_count == MACRO_QUEUE_DEPTH) {
+        return false;
+    }
+    if (macro_count == 0) {
+        if (!scheduler_add(timer_read32(), 0, macro_task, NULL)) {
+            return false;
+        }
+        macro_start(index);
+    }
+    macro_queue[(macro_head + macro_count++) % MACRO_QUEUE_DEPTH] = index;
+    return true;
+}
+
+static void macro_cancel(void) {
+    for (uint8_t i = 0; i < MACRO_HELD_MAX; i++) {
+        if (macro_held[i] != KC_NO) {
+            unregister_code(macro_held[i]);
+            macro_held[i] = KC_NO;
+        }
+    }
+    macro_count = 0;
+    scheduler_cancel(macro_task);
+}
+
+// Leader
+
+/*
+ * Leader sequences live in leader_sequences.def and are compiled into a trie
+ * in leader_trie.h by gen_tables.py. Each key advances one node, so matching
+ * costs the same however many sequences there are. A sequence fires as soon
+ * as it is unambiguous; one that is a prefix of a longer sequence fires when
+ * the leader times out.
+ */
+#define LEADER_NODE_DEAD 0xFF
+
+static uint8_t leader_node;
+
+static uint16_t leader_node_action(uint8_t node) {
+    return pgm_read_word(&leader_nodes[node].action);
+}
+
+static void leader_fire(uint16_t action) {
+    if (LEADER_ACTION_IS_STRING(action)) {
+        send_string_batched_P((const char *)pgm_read_ptr(&leader_strings[action & 0xFF]));
+    } else if (action != LEADER_ACTION_NONE) {
+        tap_code16(action);
+    }
+}
+
+void leader_start_user(void) {
+    leader_node = 0;
+}
+
+bool leader_add_user(uint16_t keycode) {
+    uint8_t first = pgm_read_byte(&leader_nodes[leader_node].first_edge);
+    uint8_t count = pgm_read_byte(&leader_nodes[leader_node].edge_count);
+    for (uint8_t edge = first; edge < first + count; edge++) {
+        if (pgm_read_word(&leader_edges[edge].keycode) == keycode) {
+            leader_node = pgm_read_byte(&leader_edges[edge].node);
+            if (pgm_read_byte(&leader_nodes[leader_node].edge_count)) {
+                return false;
+            }
+            // A leaf: nothing longer can match, so fire now.
+            leader_fire(leader_node_action(leader_node));
+            leader_node = LEADER_NODE_DEAD;
+            return true;
+        }
+    }
+    leader_node = LEADER_NODE_DEAD;
+    return true;
+}
+
+void leader_end_user(void) {
+    if (leader_node != LEADER_NODE_DEAD) {
+        leader_fire(leader_node_action(leader_node));
+    }
+}
+
+// Chords
+
+/*
+ * Chords from chords.def, matched from pre_process_record_user so they are
+ * decided before the tapping code sees either key and a held home-row mod
+ * does not delay them. Pressed keys are tracked as a bitmask per grid row.
+ * A key that belongs to a chord is held back for up to CHORD_TERM ms; if the
+ * other key of one of its chords goes down meanwhile the chord's keycode is
+ * registered instead, otherwise the held key is replayed with its original
+ * timestamp. Candidates come from chord_by_key, so matching a key only looks
+ * at the chords it belongs to.
+ */
+#define CHORD_NONE 0xFF
+
+static uint16_t chord_down[5];
+static uint8_t  chord_pending = GRID_NONE;
+static keypos_t chord_pending_key;
+static uint16_t chord_pending_time;
+static uint8_t  chord_active = CHORD_NONE;
+static uint16_t chord_held[5]; // keys of chords still down, whose releases are swallowed
+static bool     chord_replaying = false;
+
+static bool grid_bit(const uint16_t *rows, uint8_t index) {
+    return rows[index / 12] & (1 << (index % 12));
+}
+
+static bool chord_is_member(uint8_t index) {
+    return pgm_read_word(&chord_member_rows[index / 12]) & (1 << (index % 12));
+}
+
+static void chord_replay(void) {
+    keyevent_t event = MAKE_KEYEVENT(chord_pending_key.row, chord_pending_key.col, true);
+    event.time       = chord_pending_time;
+    chord_pending    = GRID_NONE;
+    chord_replaying  = true;
+    action_exec(event);
+    chord_replaying = false;
+}
+
+static uint8_t chord_match(uint8_t index) {
+    uint8_t end = pgm_read_byte(&chord_by_key_start[chord_pending + 1]);
+    for (uint8_t i = pgm_read_byte(&chord_by_key_start[chord_pending]); i < end; i++) {
+        uint8_t chord = pgm_read_byte(&chord_by_key[i]);
+        uint8_t other = pgm_read_byte(&chord_keys[chord][0]);
+        if (other == chord_pending) {
+            other = pgm_read_byte(&chord_keys[chord][1]);
+        }
+        if (other == index && grid_bit(chord_down, other)) {
+            return chord;
+        }
+    }
+    return CHORD_NONE;
+}
+
+static void chord_release_active(void) {
+    if (chord_active != CHORD_NONE) {
+        unregister_code16(pgm_read_word(&chord_keycodes[chord_active]));
+        chord_active = CHORD_NONE;
+    }
+}
+
+/* Replays a key that no second key joined within CHORD_TERM. */
+static uint32_t chord_timeout(uint32_t now, void *arg) {
+    if (chord_pending == GRID_NONE) {
+        return 0;
+    }
+    uint16_t age = event_age(chord_pending_time);
+    if (age < CHORD_TERM) {
+        return CHORD_TERM - age;
+    }
+    chord_replay();
+    return 0;
+}
+
+static bool chord_press(uint8_t index, keyrecord_t *record) {
+    if (chord_pending != GRID_NONE) {
+        uint8_t chord = chord_match(index);
+        if (chord != CHORD_NONE && TIMER_DIFF_16(record->event.time, chord_pending_time) < CHORD_TERM) {
+            chord_release_active();
+            chord_pending = GRID_NONE;
+            chord_active  = chord;
+            for (uint8_t i = 0; i < 2; i++) {
+                uint8_t key = pgm_read_byte(&chord_keys[chord][i]);
+                chord_held[key / 12] |= 1 << (key % 12);
+            }
+            register_code16(pgm_read_word(&chord_keycodes[chord]));
+            return false;
+        }
+        chord_replay();
+    }
+    // Chords only apply on the base layer, and not mid-word.
+    if (!chord_is_member(index) || get_highest_layer(layer_state) != _QWERTY || (streak_valid && TIMER_DIFF_16(record->event.time, streak_last) < STREAK_TERM)) {
+        return true;
+    }
+    chord_pending      = index;
+    chord_pending_key  = record->event.key;
+    chord_pending_time = record->event.time;
+    uint16_t age       = event_age(chord_pending_time);
+    scheduler_cancel(chord_timeout);
+    scheduler_add(timer_read32(), age < CHORD_TERM ? CHORD_TERM - age : 0, chord_timeout, NULL);
+    return false;
+}
+
+static bool chord_release(uint8_t index) {
+    // Any release lets the held key go first, so events keep their order.
+    if (chord_pending != GRID_NONE) {
+        bool own = index == chord_pending;
+        chord_replay();
+        if (own) {
+            return true;
+        }
+    }
+    if (!grid_bit(chord_held, index)) {
+        return true;
+    }
+    // A chord ends with its first key; both releases are swallowed, even
+    // once a later chord has taken over.
+    chord_held[index / 12] &= ~(1 << (index % 12));
+    if (chord_active != CHORD_NONE && (index == pgm_read_byte(&chord_keys[chord_active][0]) || index == pgm_read_byte(&chord_keys[chord_active][1]))) {
+        chord_release_active();
+    }
+    return false;
+}
+
+static bool chord_process(keyrecord_t *record) {
+    uint8_t index = grid_index(record->event.key);
+    if (chord_replaying || index == GRID_NONE) {
+        return true;
+    }
+    if (record->event.pressed) {
+        chord_down[index / 12] |= 1 << (index % 12);
+        return chord_press(index, record);
+    }
+    chord_down[index / 12] &= ~(1 << (index % 12));
+    return chord_release(index);
+}
+
+// Navigation repeat
+
+/*
+ * Arrows, Home/End and PgUp/PgDn repeat in firmware instead of at the host's
+ * rate: the key is tapped on press, again after NAV_REPEAT_DELAY ms, then
+ * every NAV_REPEAT_RATE ms shrinking by NAV_REPEAT_DECAY percent per repeat
+ * down to NAV_REPEAT_FLOOR. Only the last nav key pressed repeats. The
+ * encoder pages over the same range of speeds.
+ */
+static uint8_t  nav_keycode = KC_NO;
+static keypos_t nav_key;
+static uint16_t nav_interval;
+
+/* The interval that follows interval on the repeat curve. */
+static uint16_t nav_accel(uint16_t interval) {
+    uint16_t next = (uint32_t)interval * NAV_REPEAT_DECAY / 100;
+    return next < NAV_REPEAT_FLOOR ? NAV_REPEAT_FLOOR : next;
+}
+
+static uint32_t nav_repeat(uint32_t now, void *arg) {
+    uint16_t interval = nav_interval;
+    tap_code(nav_keycode);
+    nav_interval = nav_accel(interval);
+    return interval;
+}
+
+static bool nav_process(uint16_t keycode, keyrecord_t *record) {
+    if (record->event.pressed) {
+        nav_keycode  = keycode;
+        nav_key      = record->event.key;
+        nav_interval = NAV_REPEAT_RATE;
+        tap_code(keycode);
+        scheduler_cancel(nav_repeat);
+        scheduler_add(timer_read32(), NAV_REPEAT_DELAY, nav_repeat, NULL);
+    } else if (nav_keycode != KC_NO && KEYEQ(record->event.key, nav_key)) {
+        nav_keycode = KC_NO;
+        scheduler_cancel(nav_repeat);
+    }
+    return false;
+}
+
+// Event trace
+
+/*
+ * Every physical key event is appended to a ring of TRACE_BUFFER_SIZE
+ * records before chords, streaks or tapping touch it, so a dump is an exact
+ * input trace. DB_DUMP prints the ring to the console, oldest first, as hex
+ * records of four bytes: matrix row << 4 | column, flags (bit 0 set for a
+ * press), then the ms since the previous record as a little-endian uint16
+ * that saturates at 0xFFFF. The ring is cleared after each dump.
+ */
+typedef struct {
+    uint8_t  key;
+    uint8_t  flags;
+    uint16_t delta;
+} trace_record_t;
+
+#define TRACE_PRESSED 0x01
+
+static trace_record_t trace_buffer[TRACE_BUFFER_SIZE];
+static uint16_t       trace_head  = 0;
+static uint16_t       trace_count = 0;
+static uint16_t       trace_last_time;
+static uint32_t       trace_last_time32;
+
+static void trace_record(keyrecord_t *record) {
+    uint32_t now   = timer_read32();
+    uint32_t delta = trace_count ? now - trace_last_time32 : 0;
+    // event.time is when the scan saw the change but wraps every 65 s, so the
+    // 32-bit clock only decides whether the gap saturates.
+    if (trace_count && delta < UINT16_MAX) {
+        delta = TIMER_DIFF_16(record->event.time, trace_last_time);
+    }
+    trace_last_time   = record->event.time;
+    trace_last_time32 = now;
+
+    trace_record_t *entry = &trace_buffer[(trace_head + trace_count) % TRACE_BUFFER_SIZE];
+    entry->key            = record->event.key.row << 4 | record->event.key.col;
+    entry->flags          = record->event.pressed ? TRACE_PRESSED : 0;
+    entry->delta          = delta > UINT16_MAX ? UINT16_MAX : delta;
+    if (trace_count < TRACE_BUFFER_SIZE) {
+        trace_count++;
+    } else {
+        trace_head = (trace_head + 1) % TRACE_BUFFER_SIZE;
+    }
+}
+
+static void trace_dump(void) {
+    uprintf("trace: %u records\n", trace_count);
+    for (uint16_t i = 0; i < trace_count; i++) {
+        trace_record_t *entry = &trace_buffer[(trace_head + i) % TRACE_BUFFER_SIZE];
+        uprintf("%02X%02X%02X%02X", entry->key, entry->flags, entry->delta & 0xFF, entry->delta >> 8);
+        if (i % 16 == 15 || i == trace_count - 1) {
+            uprintf("\n");
+        }
+    }
+    trace_head  = 0;
+    trace_count = 0;
+}
+
+// Heatmap
+
+/*
+ * Presses per grid position and highest active layer, in saturating 16-bit
+ * counters. They are counted before chords or streaks touch the event, so
+ * they reflect the physical key. They are saved at the end of the EEPROM
+ * user datablock only when DB_DUMP prints them and when the host suspends
+ * the keyboard, and only if they changed, so typing alone never writes.
+ * DB_DUMP prints them after a "heatmap: layers rows cols" line as one line
+ * of hex per layer and grid row, each counter a little-endian uint16.
  */
-[_RAISE] = LAYOUT_preonic_grid(
-    _______, _______, _______, _______, _______, _______, _______, _______, _______, _______, _______, _______,
-    KC_GRV,  KC_1,    KC_2,    KC_3,    KC_4,    KC_5,    KC_6,    KC_7,    KC_8,    KC_9,    KC_0,    KC_DEL,
-    KC_ESC,  KC_F1,   KC_F2,   KC_F3,   KC_F4,   KC_F5,   KC_F6,   KC_DOWN, KC_UP,   KC_LBRC, KC_RBRC, KC_PGUP,
-    KC_LSFT, KC_F7,   KC_F8,   KC_F9,   KC_F10,  KC_F11,  KC_F12,  _______, KC_HOME, KC_END,  KC_PIPE, KC_PGDN,
-    _______, _______, _______, _______, _______, KC_UNDS, KC_UNDS, _______, KC_MUTE, KC_VOLD, KC_VOLU, KC_MPLY
-),
+#define HEATMAP_LAYERS (_ADJUST + 1)
+#define HEATMAP_MAGIC 0x4D48 // "HM"
 
-/* ADJUST
- * ┌──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┬──────┐
- * │  F1  │  F2  │  F3  │  F4  │  F5  │  F6  │  F7  │  F8  │  F9  │ F10  │ F11  │ F12  │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │      │ BOOT │  DB  │      │      │      │      │      │      │      │      │ Del  │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │      │      │      │ AuOn │AuOff │ AGNr │ AGSw │  M1  │  M2  │  M3  │  M4  │      │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │      │      │      │ MuOn │MuOff │ MiOn │MiOff │  M5  │  M6  │      │      │      │
- * ├──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┼──────┤
- * │ Lght │      │      │      │      │      │      │      │      │ DOWN │  UP  │ PRNT │
- * └──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┴──────┘
+typedef struct {
+    uint16_t magic;
+    uint16_t counts[HEATMAP_LAYERS][5 * 12];
+} heatmap_t;
+
+static heatmap_t heatmap;
+static bool      heatmap_dirty = false;
+
+#define HEATMAP_ADDRESS (EECONFIG_USER_DATABLOCK + EECONFIG_USER_DATA_SIZE - sizeof(heatmap_t))
+
+static void heatmap_count(keyrecord_t *record) {
+    uint8_t index = grid_index(record->event.key);
+    uint8_t layer = get_highest_layer(layer_state);
+    if (!record->event.pressed || index == GRID_NONE || layer >= HEATMAP_LAYERS) {
+        return;
+    }
+    uint16_t *count = &heatmap.counts[layer][index];
+    if (*count < UINT16_MAX) {
+        (*count)++;
+        heatmap_dirty = true;
+    }
+}
+
+static void heatmap_load(void) {
+    eeprom_read_block(&heatmap, HEATMAP_ADDRESS, sizeof(heatmap));
+    if (heatmap.magic != HEATMAP_MAGIC) {
+        memset(&heatmap, 0, sizeof(heatmap));
+        heatmap.magic = HEATMAP_MAGIC;
+    }
+}
+
+static void heatmap_save(void) {
+    if (heatmap_dirty) {
+        eeprom_update_block(&heatmap, HEATMAP_ADDRESS, sizeof(heatmap));
+        heatmap_dirty = false;
+    }
+}
+
+static void heatmap_dump(void) {
+    heatmap_save();
+    uprintf("heatmap: %u 5 12\n", HEATMAP_LAYERS);
+    for (uint8_t layer = 0; layer < HEATMAP_LAYERS; layer++) {
+        for (uint8_t i = 0; i < 5 * 12; i++) {
+            uint16_t count = heatmap.counts[layer][i];
+            uprintf("%02X%02X", count & 0xFF, count >> 8);
+            if (i % 12 == 11) {
+                uprintf("\n");
+            }
+        }
+    }
+}
+
+bool pre_process_record_user(uint16_t keycode, keyrecord_t *record) {
+    if (!chord_replaying) {
+        trace_record(record);
+        heatmap_count(record);
+        if (record->event.pressed) {
+            boot_key_pressed();
+        }
+    }
+    if (!chord_process(record)) {
+        return false;
+    }
+    return record->event.pressed ? streak_press(keycode, record) : streak_release(record);
+}
+
+/*
+ * The basic keycode a press types, for expand_press. Modifiers, layer keys
+ * and mod-tap holds type nothing and give KC_NO. Everything else that is
+ * not a basic keycode gives EXPAND_CLEAR: tap dances, shifted keycodes such
+ * as KC_LPRN and custom keys type output the buffer cannot follow.
  */
-[_ADJUST] = LAYOUT_preonic_grid(
-    KC_F1,   KC_F2,   KC_F3,   KC_F4,   KC_F5,   KC_F6,   KC_F7,   KC_F8,   KC_F9,    KC_F10,  KC_F11,  KC_F12,
-    _______, QK_BOOT, DB_TOGG, _______, _______, _______, _______, _______, _______,  _______, _______, KC_DEL,
-    _______, _______, _______,  AU_ON,   AU_OFF,  AG_NORM, AG_SWAP, MACKEY1, MACKEY2, MACKEY3, MACKEY4, _______,
-    _______, _______, _______,  MU_ON,   MU_OFF,  MI_ON,   MI_OFF,  MACKEY5, MACKEY6, _______, _______, _______,
-    BACKLIT, _______, _______, _______, _______, _______, _______, _______, _______,  DT_DOWN, DT_UP,   DT_PRNT
-)
+static uint8_t expand_keycode(uint16_t keycode, keyrecord_t *record) {
+    if (IS_QK_MOD_TAP(keycode)) {
+        return record->tap.count ? QK_MOD_TAP_GET_TAP_KEYCODE(keycode) : KC_NO;
+    }
+    if (IS_BASIC_KEYCODE(keycode)) {
+        return keycode;
+    }
+    if (IS_QK_MODS(keycode) && (keycode & 0xFF) == KC_NO) {
+        return KC_NO; // KC_HYPR and friends
+    }
+    switch (keycode) {
+    case KC_NO:
+    case KC_TRNS:
+    case KC_LCTL ... KC_RGUI:
+    case QK_ONE_SHOT_MOD ... QK_ONE_SHOT_MOD_MAX:
+    case LOWER:
+    case RAISE:
+        return KC_NO;
+    default:
+        return EXPAND_CLEAR;
+    }
+}
 
-}; // keymaps
-// clang-format on
+static bool process_record_keymap(uint16_t keycode, keyrecord_t *record) {
+    hrm_learn(keycode, record);
+    streak_note(keycode, record);
+    if (record->event.pressed && !expand_press(expand_keycode(keycode, record))) {
+        return false;
+    }
 
-bool process_record_user(uint16_t keycode, keyrecord_t *record) {
     switch (keycode) {
     case LOWER:
-        if (record->event.pressed) {
-            layer_on(_LOWER);
-            update_tri_layer(_LOWER, _RAISE, _ADJUST);
-        } else {
-            layer_off(_LOWER);
-            update_tri_layer(_LOWER, _RAISE, _ADJUST);
-        }
+        layer_input(LAYER_INPUT_LOWER, record->event.pressed);
         return false;
     case RAISE:
-        if (record->event.pressed) {
-            layer_on(_RAISE);
-            update_tri_layer(_LOWER, _RAISE, _ADJUST);
-        } else {
-            layer_off(_RAISE);
-            update_tri_layer(_LOWER, _RAISE, _ADJUST);
-        }
+        layer_input(LAYER_INPUT_RAISE, record->event.pressed);
         return false;
     case BACKLIT:
         if (record->event.pressed) {
@@ -440,135 +1684,612 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
         return false;
     case TRAILING_SEMICOLON:
         if (record->event.pressed) {
-            SEND_STRING(SS_TAP(X_END)";");
+            SEND_STRING_BATCHED(SS_TAP(X_END)";");
             return false;
         }
         break;
     case TRAILING_COMMA:
         if (record->event.pressed) {
-            SEND_STRING(SS_TAP(X_END)",");
+            SEND_STRING_BATCHED(SS_TAP(X_END)",");
             return false;
         }
         break;
     case RIGHT_ARROW:
         if (record->event.pressed) {
-            SEND_STRING("->");
-            return false;
-        }
-        break;
-    case MACKEY1:
-        if (record->event.pressed) {
-            send_string_with_delay_P(MACRO_STRING1, 10);
+            SEND_STRING_BATCHED("->");
             return false;
         }
         break;
-    case MACKEY2:
+    case KC_LEFT:
+    case KC_DOWN:
+    case KC_UP:
+    case KC_RGHT:
+    case KC_HOME:
+    case KC_END:
+    case KC_PGUP:
+    case KC_PGDN:
+        return nav_process(keycode, record);
+    case MACKEY1 ... MACKEY6:
         if (record->event.pressed) {
-            send_string_with_delay_P(MACRO_STRING2, 10);
-            return false;
+            macro_enqueue(keycode - MACKEY1);
         }
-        break;
-    case MACKEY3:
+        return false;
+    case MACRO_STOP:
         if (record->event.pressed) {
-            send_string_with_delay_P(MACRO_STRING3, 10);
-            return false;
+            macro_cancel();
         }
-        break;
-    case MACKEY4:
+        return false;
+    case DT_PRNT:
         if (record->event.pressed) {
-            send_string_with_delay_P(MACRO_STRING4, 10);
-            return false;
+            hrm_print_terms();
         }
-        break;
-    case MACKEY5:
+        return false;
+    case DEBUG_DUMP:
         if (record->event.pressed) {
-            send_string_with_delay_P(MACRO_STRING5, 10);
-            return false;
+            trace_dump();
+            debounce_dump();
+            heatmap_dump();
+            boot_dump();
         }
-        break;
-    case MACKEY6:
-      if (record->event.pressed) {
-        send_string_with_delay_P(MACRO_STRING6, 10);
         return false;
-      }
-      break;
     }
     return true;
 }
 
+bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+    if (!debug_enable) {
+        return process_record_keymap(keycode, record);
+    }
+    if (IS_QK_TAP_DANCE(keycode) && record->event.pressed) {
+        instr_dance_pressed = record->event.time;
+    }
+    uint32_t start  = INSTR_NOW();
+    bool     result = process_record_keymap(keycode, record);
+    uint32_t spent  = INSTR_NOW() - start;
+    if (spent > instr_worst) {
+        instr_worst = spent;
+    }
+    return result;
+}
+
+void post_process_record_user(uint16_t keycode, keyrecord_t *record) {
+    if (record->event.pressed) {
+        boot_key_sent();
+    }
+    if (!debug_enable || !record->event.pressed || IS_QK_TAP_DANCE(keycode)) {
+        return;
+    }
+    instr_latency_add(is_home_row_mod(keycode) ? INSTR_HOME_ROW : INSTR_PLAIN, record->event.time);
+}
+
 // Muse
 
-bool muse_mode = false;
-uint8_t last_muse_note = 0;
-uint16_t muse_counter = 0;
-uint8_t muse_offset = 70;
-uint16_t muse_tempo = 50;
+bool     muse_mode    = false;
+bool     muse_playing = false;
+uint8_t  muse_offset  = MUSE_OFFSET_DEFAULT;
+uint16_t muse_tempo   = MUSE_TEMPO_DEFAULT; // beats per minute
+uint8_t  muse_density = MUSE_DENSITY_DEFAULT;
+uint8_t  muse_scale   = 0; // index into muse_scales
+uint8_t  muse_spread  = MUSE_SPREAD_DEFAULT; // octaves above the lowest
 
-bool encoder_update_user(uint8_t index, bool clockwise) {
-    if (muse_mode) {
-        if (IS_LAYER_ON(_RAISE)) {
-            if (clockwise) {
-                muse_offset++;
-            } else {
-                muse_offset--;
+/*
+ * A small generative sequencer. Each voice gets a chance to start a note on
+ * its steps of the bar; the note holds until that voice's next one. Bars are
+ * generated one ahead into a pair of event lists, so the scheduled task only
+ * pops events whose step is due and, once a bar, refills the list it has
+ * just finished with the bar after next. Parameter changes are heard from
+ * that bar on.
+ *
+ * Steps are timed on the clock, not on matrix scans, so the tempo does not
+ * depend on scan rate or typing. The step period is kept in 1/256 ms and a
+ * step's time is worked out from the start of its bar, so tempos that do not
+ * divide a minute evenly do not drift.
+ */
+#define MUSE_STEPS_PER_BAR (4 * MUSE_STEPS_PER_BEAT)
+#define MUSE_SCALE_DEGREES 7
+
+enum muse_voice_names {
+    MUSE_BASS,  // root or fifth on the strong beats, an octave down
+    MUSE_LEAD,  // steps around the scale across muse_spread octaves
+    MUSE_CHIME, // sparse notes anywhere in the range, an octave up
+    MUSE_VOICES
+};
+
+typedef struct {
+    uint8_t every;  // steps between chances to start a note
+    uint8_t chance; // in 64, at MUSE_DENSITY_DEFAULT
+    int8_t  octave; // relative to muse_offset
+    uint8_t volume;
+} muse_voice_t;
+
+// clang-format off
+static const muse_voice_t muse_voices[MUSE_VOICES] PROGMEM = {
+    [MUSE_BASS]  = {MUSE_STEPS_PER_BEAT * 2, 64, -1, 0xF},
+    [MUSE_LEAD]  = {1,                       20,  0, 0xC},
+    [MUSE_CHIME] = {2,                        6,  1, 0x8},
+};
+
+/* Semitones of each degree; pentatonics repeat into the next octave. */
+static const uint8_t muse_scales[][MUSE_SCALE_DEGREES] PROGMEM = {
+    {0, 2, 4, 5, 7, 9, 11},   // major
+    {0, 2, 3, 5, 7, 8, 10},   // natural minor
+    {0, 2, 3, 5, 7, 9, 10},   // dorian
+    {0, 2, 4, 7, 9, 12, 14},  // major pentatonic
+    {0, 3, 5, 7, 10, 12, 15}, // minor pentatonic
+};
+// clang-format on
+
+#define MUSE_SCALES (sizeof(muse_scales) / sizeof(muse_scales[0]))
+
+/* The bass plays an octave below muse_offset and the chime reaches the top
+   degree of the widest scale (15) an octave above the spread, so these keep
+   every note within MIDI 1..127; 0 marks a silent voice. */
+_Static_assert(MUSE_OFFSET_MIN - 12 > 0, "MUSE_OFFSET_MIN too low");
+_Static_assert(MUSE_OFFSET_MAX + 12 * (1 + MUSE_SPREAD_MAX) + 15 <= 127, "MUSE_OFFSET_MAX too high");
+_Static_assert(MUSE_OFFSET_DEFAULT >= MUSE_OFFSET_MIN && MUSE_OFFSET_DEFAULT <= MUSE_OFFSET_MAX, "MUSE_OFFSET_DEFAULT out of range");
+
+typedef struct {
+    uint8_t step;
+    uint8_t voice;
+    uint8_t note;
+} muse_event_t;
+
+typedef struct {
+    uint8_t      count;
+    muse_event_t events[MUSE_STEPS_PER_BAR * MUSE_VOICES];
+} muse_bar_t;
+
+static muse_bar_t muse_bars[2];
+static uint8_t    muse_bar;        // index of the bar playing
+static uint8_t    muse_cursor;     // next event in that bar
+static uint32_t   muse_bar_start;  // ms
+static uint8_t    muse_bar_frac;   // 1/256 ms
+static uint32_t   muse_period_q8;  // step period in 1/256 ms
+static uint8_t    muse_notes[MUSE_VOICES]; // sounding note per voice, 0 if none
+static uint8_t    muse_lead_degree;
+static uint16_t   muse_seed = 1;
+
+static int16_t muse_clamp(int16_t value, int16_t min, int16_t max) {
+    return value < min ? min : value > max ? max : value;
+}
+
+static void muse_set_tempo(int16_t tempo) {
+    muse_tempo     = muse_clamp(tempo, MUSE_TEMPO_MIN, MUSE_TEMPO_MAX);
+    muse_period_q8 = (60000UL << 8) / ((uint32_t)muse_tempo * MUSE_STEPS_PER_BEAT);
+}
+
+static void muse_set_offset(int16_t offset) {
+    muse_offset = muse_clamp(offset, MUSE_OFFSET_MIN, MUSE_OFFSET_MAX);
+}
+
+static void muse_set_density(int16_t density) {
+    muse_density = muse_clamp(density, 0, MUSE_DENSITY_MAX);
+}
+
+static void muse_set_scale(int16_t scale) {
+    muse_scale = muse_clamp(scale, 0, MUSE_SCALES - 1);
+}
+
+static void muse_set_spread(int16_t spread) {
+    muse_spread = muse_clamp(spread, 0, MUSE_SPREAD_MAX);
+}
+
+/* Encoder detents in muse mode: tempo, or with a key held, the scale (LOWER
+   and RAISE), base note (RAISE), density (LOWER) or spread (Shift). The keys
+   are read from layer_inputs, so the DIP switch's _ADJUST does not count. */
+static void muse_adjust(int8_t detents) {
+    uint8_t held = layer_inputs & (LAYER_INPUT_LOWER | LAYER_INPUT_RAISE);
+    if (held == (LAYER_INPUT_LOWER | LAYER_INPUT_RAISE)) {
+        muse_set_scale(muse_scale + detents);
+    } else if (held == LAYER_INPUT_RAISE) {
+        muse_set_offset(muse_offset + detents);
+    } else if (held == LAYER_INPUT_LOWER) {
+        muse_set_density(muse_density + detents);
+    } else if (get_mods() & MOD_MASK_SHIFT) {
+        muse_set_spread(muse_spread + detents);
+    } else {
+        muse_set_tempo(muse_tempo + detents);
+    }
+}
+
+#ifdef AUDIO_ENABLE
+/* xorshift16 */
+static uint16_t muse_random(void) {
+    muse_seed ^= muse_seed << 7;
+    muse_seed ^= muse_seed >> 9;
+    muse_seed ^= muse_seed << 8;
+    return muse_seed;
+}
+
+static uint8_t muse_note(uint8_t degree, int8_t octave) {
+    return muse_offset + 12 * (octave + degree / MUSE_SCALE_DEGREES) + pgm_read_byte(&muse_scales[muse_scale][degree % MUSE_SCALE_DEGREES]);
+}
+
+/* Fills muse_bars[index] with the events of a new bar. */
+static void muse_generate(uint8_t index) {
+    muse_bar_t *bar     = &muse_bars[index];
+    uint8_t     degrees = MUSE_SCALE_DEGREES * (muse_spread + 1);
+
+    bar->count = 0;
+    for (uint8_t step = 0; step < MUSE_STEPS_PER_BAR; step++) {
+        for (uint8_t voice = 0; voice < MUSE_VOICES; voice++) {
+            muse_voice_t v;
+            memcpy_P(&v, &muse_voices[voice], sizeof(v));
+            uint16_t chance = (uint16_t)v.chance * muse_density / MUSE_DENSITY_DEFAULT;
+            if (step % v.every || (muse_random() & 63) >= chance) {
+                continue;
             }
-        } else {
-            if (clockwise) {
-                muse_tempo += 1;
-            } else {
-                muse_tempo -= 1;
+            uint8_t degree;
+            switch (voice) {
+            case MUSE_BASS:
+                degree = (muse_random() & 1) ? 4 : 0;
+                break;
+            case MUSE_LEAD: {
+                // A step of up to two degrees either way, kept in range.
+                int8_t lead = muse_lead_degree + (int8_t)(muse_random() % 5) - 2;
+                if (lead < 0) {
+                    lead = 0;
+                } else if (lead >= degrees) {
+                    lead = degrees - 1;
+                }
+                degree = muse_lead_degree = lead;
+                break;
             }
+            default:
+                degree = muse_random() % degrees;
+                break;
+            }
+            bar->events[bar->count++] = (muse_event_t){step, voice, muse_note(degree, v.octave)};
         }
-    } else {
-        if (clockwise) {
-            register_code(KC_PGDN);
-            unregister_code(KC_PGDN);
-        } else {
-            register_code(KC_PGUP);
-            unregister_code(KC_PGUP);
+    }
+}
+
+static uint32_t muse_step_time(uint8_t step) {
+    return muse_bar_start + ((muse_bar_frac + step * muse_period_q8) >> 8);
+}
+
+static void muse_play(const muse_event_t *event) {
+    uint8_t *sounding = &muse_notes[event->voice];
+    if (*sounding) {
+        stop_note(midi_note_freq(*sounding));
+    }
+    play_note(midi_note_freq(event->note), pgm_read_byte(&muse_voices[event->voice].volume));
+    *sounding = event->note;
+}
+
+/* Plays the events that are due, returning the delay until the next one. */
+static uint32_t muse_tick(uint32_t now) {
+    if (!muse_playing) {
+        muse_playing   = true;
+        muse_bar       = 0;
+        muse_cursor    = 0;
+        muse_bar_start = now;
+        muse_bar_frac  = 0;
+        muse_seed ^= now | 1;
+        if (!muse_seed) {
+            muse_seed = 1; // xorshift never leaves 0
+        }
+        memset(muse_notes, 0, sizeof(muse_notes));
+        if (!muse_period_q8) {
+            muse_set_tempo(muse_tempo);
+        }
+        muse_generate(0);
+        muse_generate(1);
+    }
+    for (;;) {
+        muse_bar_t *bar = &muse_bars[muse_bar];
+        while (muse_cursor < bar->count) {
+            uint32_t due = muse_step_time(bar->events[muse_cursor].step);
+            if (!timer_expired32(now, due)) {
+                return due - now;
+            }
+            muse_play(&bar->events[muse_cursor++]);
+        }
+        uint32_t end = muse_step_time(MUSE_STEPS_PER_BAR);
+        if (!timer_expired32(now, end)) {
+            return end - now;
         }
+        uint32_t length = (uint32_t)muse_bar_frac + MUSE_STEPS_PER_BAR * muse_period_q8;
+        muse_bar_start += length >> 8;
+        muse_bar_frac = length & 0xFF;
+        if (timer_expired32(now, muse_step_time(MUSE_STEPS_PER_BAR))) {
+            // Fell more than a bar behind; resync rather than play a burst.
+            muse_bar_start = now;
+            muse_bar_frac  = 0;
+        }
+        muse_generate(muse_bar);
+        muse_bar ^= 1;
+        muse_cursor = 0;
+    }
+}
+
+/* Scheduled while muse_mode is on, and once more to stop when it turns off. */
+static uint32_t muse_task(uint32_t now, void *arg) {
+    if (!muse_mode) {
+        if (muse_playing) {
+            stop_all_notes();
+            muse_playing = false;
+        }
+        return 0;
+    }
+    if (!debug_enable) {
+        return muse_tick(now);
+    }
+    uint32_t start = INSTR_NOW();
+    uint32_t delay = muse_tick(now);
+    uint32_t spent = INSTR_NOW() - start;
+    if (spent > instr_muse_worst) {
+        instr_muse_worst = spent;
+    }
+    return delay;
+}
+#endif
+
+// Encoder
+
+/*
+ * Detents are only counted in encoder_update_user and applied by a
+ * scheduled flush at most once per ENCODER_FLUSH_INTERVAL ms (one USB
+ * frame). The time since the previous detent gives the spin speed, and
+ * encoder_accel scales each detent by how much shorter than NAV_REPEAT_RATE
+ * that gap is, up to NAV_REPEAT_RATE / NAV_REPEAT_FLOOR times, so paging
+ * speeds up over the same range as a held nav key. Paging sends at most one
+ * PgUp/PgDn tap per flush from a bounded backlog, so a fast spin never
+ * floods the host, and reversing direction drops whatever is still pending.
+ */
+static int8_t   encoder_detents = 0; // accelerated detents since the last flush
+static int8_t   encoder_pages   = 0; // page taps still to send
+static uint16_t encoder_last_detent;
+static uint16_t encoder_flush_timer;
+
+static uint8_t encoder_accel(uint16_t gap) {
+    if (gap < NAV_REPEAT_FLOOR) {
+        gap = NAV_REPEAT_FLOOR;
+    }
+    return gap < NAV_REPEAT_RATE ? NAV_REPEAT_RATE / gap : 1;
+}
+
+/* Runs while detents or page taps are pending. */
+static uint32_t encoder_task(uint32_t now, void *arg) {
+    if (!encoder_detents && !encoder_pages) {
+        return 0;
+    }
+    encoder_flush_timer = timer_read();
+
+    int8_t detents  = encoder_detents;
+    encoder_detents = 0;
+    if (muse_mode) {
+        // Pages still pending from before muse mode are dropped.
+        encoder_pages = 0;
+        muse_adjust(detents);
+        return 0;
+    }
+
+    if (detents && (detents > 0) != (encoder_pages > 0)) {
+        encoder_pages = 0;
+    }
+    // Summed wide: a full backlog plus a fast spin overflows an int8_t.
+    int16_t pages = encoder_pages + detents;
+    if (pages > ENCODER_PAGES_MAX) {
+        pages = ENCODER_PAGES_MAX;
+    } else if (pages < -ENCODER_PAGES_MAX) {
+        pages = -ENCODER_PAGES_MAX;
+    }
+    encoder_pages = pages;
+    if (encoder_pages > 0) {
+        tap_code(KC_PGDN);
+        encoder_pages--;
+    } else if (encoder_pages < 0) {
+        tap_code(KC_PGUP);
+        encoder_pages++;
+    }
+    return encoder_pages ? ENCODER_FLUSH_INTERVAL : 0;
+}
+
+bool encoder_update_user(uint8_t index, bool clockwise) {
+    uint16_t now   = timer_read();
+    int8_t   steps = encoder_accel(TIMER_DIFF_16(now, encoder_last_detent));
+    encoder_last_detent = now;
+    if (clockwise ? encoder_detents <= INT8_MAX - steps : encoder_detents >= INT8_MIN + steps) {
+        encoder_detents += clockwise ? steps : -steps;
+    }
+    if (!scheduler_pending(encoder_task)) {
+        uint16_t since = TIMER_DIFF_16(now, encoder_flush_timer);
+        uint16_t delay = since < ENCODER_FLUSH_INTERVAL ? ENCODER_FLUSH_INTERVAL - since : 0;
+        scheduler_add(timer_read32(), delay, encoder_task, NULL);
     }
     return true;
 }
 
+// Settings
+
+/*
+ * The dynamic tapping term, muse parameters and the learned home-row
+ * terms persist in the EEPROM user datablock. The datablock holds
+ * SETTINGS_SLOTS copies written round-robin, each with a sequence number and
+ * checksum, so every slot wears at a fraction of the write rate and a write
+ * cut short by unplugging only loses that write. Boot reads the slots in one
+ * pass and keeps the newest valid one.
+ *
+ * settings_task polls the tunables every SETTINGS_POLL_INTERVAL ms rather
+ * than hooking every place that changes them, and writes SETTINGS_SAVE_DELAY
+ * ms after the last change, so a burst of encoder detents or DT_UP presses
+ * costs one write. Home-row learning only triggers a write every
+ * HRM_TERM_SAVE_INTERVAL. Audio on/off and AG_SWAP are already kept in
+ * eeconfig by QMK.
+ */
+typedef struct {
+    uint16_t tapping_term;
+    uint16_t muse_tempo;
+    uint8_t  muse_offset;
+    uint8_t  muse_density;
+    uint8_t  muse_scale;
+    uint8_t  muse_spread;
+} settings_tunables_t;
+
+typedef struct {
+    uint8_t             sequence;
+    uint8_t             check; // ~sum of the other bytes
+    settings_tunables_t tunables;
+    uint8_t             hrm_mean[HRM_KEYS]; // 4 ms units
+    uint8_t             hrm_dev[HRM_KEYS];
+} settings_slot_t;
+
+#define SETTINGS_POLL_INTERVAL 100
+
+// The heatmap takes the end of the datablock.
+_Static_assert(SETTINGS_SLOTS * sizeof(settings_slot_t) + sizeof(heatmap_t) <= EECONFIG_USER_DATA_SIZE, "EECONFIG_USER_DATA_SIZE too small");
+#if defined(EECONFIG_SIZE) && defined(TOTAL_EEPROM_BYTE_COUNT)
+_Static_assert(EECONFIG_SIZE <= TOTAL_EEPROM_BYTE_COUNT, "EECONFIG_USER_DATA_SIZE does not fit in the EEPROM");
+#endif
+
+static settings_slot_t     settings_saved; // contents of the newest slot
+static uint8_t             settings_slot;  // index of the newest slot
+static settings_tunables_t settings_seen;  // tunables at the last poll
+static bool                settings_pending = false;
+static uint32_t            settings_changed_at;
+static uint32_t            settings_saved_at;
+
+static void settings_read_tunables(settings_tunables_t *tunables) {
+    memset(tunables, 0, sizeof(*tunables));
+    tunables->tapping_term = g_tapping_term;
+    tunables->muse_tempo   = muse_tempo;
+    tunables->muse_offset  = muse_offset;
+    tunables->muse_density = muse_density;
+    tunables->muse_scale   = muse_scale;
+    tunables->muse_spread  = muse_spread;
+}
+
+static uint8_t settings_checksum(const settings_slot_t *slot) {
+    const uint8_t *bytes = (const uint8_t *)slot;
+    uint8_t        sum   = 0;
+    for (uint8_t i = 0; i < sizeof(*slot); i++) {
+        if (i != offsetof(settings_slot_t, check)) {
+            sum += bytes[i];
+        }
+    }
+    return ~sum;
+}
+
+static uint8_t *settings_address(uint8_t index) {
+    return EECONFIG_USER_DATABLOCK + index * sizeof(settings_slot_t);
+}
+
+static void settings_load(void) {
+    bool            found = false;
+    settings_slot_t slot;
+    for (uint8_t i = 0; i < SETTINGS_SLOTS; i++) {
+        eeprom_read_block(&slot, settings_address(i), sizeof(slot));
+        if (slot.check != settings_checksum(&slot)) {
+            continue;
+        }
+        // Valid slots hold consecutive sequence numbers, so the newest is
+        // the one furthest ahead modulo 256.
+        if (!found || (int8_t)(slot.sequence - settings_saved.sequence) > 0) {
+            settings_saved = slot;
+            settings_slot  = i;
+            found          = true;
+        }
+    }
+    if (found) {
+        g_tapping_term = settings_saved.tunables.tapping_term;
+        muse_set_tempo(settings_saved.tunables.muse_tempo);
+        muse_set_offset(settings_saved.tunables.muse_offset);
+        muse_set_density(settings_saved.tunables.muse_density);
+        muse_set_scale(settings_saved.tunables.muse_scale);
+        muse_set_spread(settings_saved.tunables.muse_spread);
+        for (uint8_t i = 0; i < HRM_KEYS; i++) {
+            hrm_mean[i] = settings_saved.hrm_mean[i] << 6;
+            hrm_dev[i]  = settings_saved.hrm_dev[i] << 6;
+        }
+    } else {
+        settings_slot = SETTINGS_SLOTS - 1;
+        settings_read_tunables(&settings_saved.tunables);
+    }
+    settings_seen     = settings_saved.tunables;
+    settings_saved_at = timer_read32();
+}
+
+static void settings_save(void) {
+    settings_slot_t slot;
+    memset(&slot, 0, sizeof(slot));
+    slot.sequence = settings_saved.sequence + 1;
+    settings_read_tunables(&slot.tunables);
+    for (uint8_t i = 0; i < HRM_KEYS; i++) {
+        slot.hrm_mean[i] = hrm_stored(hrm_mean[i]);
+        slot.hrm_dev[i]  = hrm_stored(hrm_dev[i]);
+    }
+    slot.check = settings_checksum(&slot);
+
+    settings_slot = (settings_slot + 1) % SETTINGS_SLOTS;
+    eeprom_update_block(&slot, settings_address(settings_slot), sizeof(slot));
+    settings_saved    = slot;
+    settings_saved_at = timer_read32();
+    hrm_dirty         = false;
+}
+
+static uint32_t settings_task(uint32_t now, void *arg) {
+    settings_tunables_t tunables;
+    settings_read_tunables(&tunables);
+    if (memcmp(&tunables, &settings_seen, sizeof(tunables))) {
+        settings_seen       = tunables;
+        settings_changed_at = now;
+        settings_pending    = true;
+    }
+
+    if (settings_pending) {
+        if (now - settings_changed_at < SETTINGS_SAVE_DELAY) {
+            return SETTINGS_POLL_INTERVAL;
+        }
+        settings_pending = false;
+        // A burst that ended where it started needs no write.
+        if (hrm_dirty || memcmp(&tunables, &settings_saved.tunables, sizeof(tunables))) {
+            settings_save();
+        }
+    } else if (hrm_dirty && now - settings_saved_at >= HRM_TERM_SAVE_INTERVAL) {
+        settings_save();
+    }
+    return SETTINGS_POLL_INTERVAL;
+}
+
 bool dip_switch_update_user(uint8_t index, bool active) {
     switch (index) {
     case 0:
-        if (active) {
-            layer_on(_ADJUST);
-        } else {
-            layer_off(_ADJUST);
-        }
+        layer_input(LAYER_INPUT_DIP, active);
         break;
     case 1:
-        if (active) {
-            muse_mode = true;
-        } else {
-            muse_mode = false;
-        }
+        muse_mode = active;
+#ifdef AUDIO_ENABLE
+        scheduler_add(timer_read32(), 0, muse_task, NULL);
+#endif
     }
     return true;
 }
 
+/*
+ * Each callback is pending at most once, so the heap never holds more than
+ * the keymap's distinct callbacks: boot_song_task, macro_task,
+ * chord_timeout, nav_repeat, encoder_task, settings_task and muse_task.
+ * With room for all of them scheduler_add cannot fail; macro_enqueue still
+ * checks it, since it already has a failure path for a full queue.
+ */
+#define SCHEDULER_CALLBACKS 7
+_Static_assert(SCHEDULER_CAPACITY >= SCHEDULER_CALLBACKS, "SCHEDULER_CAPACITY too small for the keymap's callbacks");
+
 void matrix_scan_user(void) {
-#ifdef AUDIO_ENABLE
-    if (muse_mode) {
-        if (muse_counter == 0) {
-            uint8_t muse_note = muse_offset + SCALE[muse_clock_pulse()];
-            if (muse_note != last_muse_note) {
-                stop_note(compute_freq_for_midi_note(last_muse_note));
-                play_note(compute_freq_for_midi_note(muse_note), 0xF);
-                last_muse_note = muse_note;
-            }
-        }
-        muse_counter = (muse_counter + 1) % muse_tempo;
-    } else {
-        if (muse_counter) {
-            stop_all_notes();
-            muse_counter = 0;
-        }
-    }
-#endif
+    instr_task();
+    scheduler_run(timer_read32());
+}
+
+void keyboard_post_init_user(void) {
+    settings_load();
+    heatmap_load();
+
+    scheduler_add(timer_read32(), SETTINGS_POLL_INTERVAL, settings_task, NULL);
+}
+
+void suspend_power_down_user(void) {
+    heatmap_save();
 }
 
 bool music_mask_user(uint16_t keycode) {
@@ -0,0 +1,78 @@
+/* Generated by gen_tables.py from leader_sequences.def; do not edit. */
+
+#pragma once
+
+#define LEADER_ACTION_NONE 0
+#define LEADER_ACTION_STRING(index) (0x8000 | (index))
+#define LEADER_ACTION_IS_STRING(action) ((action) & 0x8000)
+
+typedef struct {
+    uint16_t action;
+    uint8_t  first_edge;
+    uint8_t  edge_count;
+} leader_node_t;
+
+typedef struct {
+    uint16_t keycode;
+    uint8_t  node;
+} leader_edge_t;
+
+static const char leader_string0[] PROGMEM = "->";
+static const char leader_string1[] PROGMEM = "=>";
+static const char leader_string2[] PROGMEM = ":=";
+static const char leader_string3[] PROGMEM = "!=";
+static const char leader_string4[] PROGMEM = "==";
+static const char leader_string5[] PROGMEM = "<=";
+static const char leader_string6[] PROGMEM = ">=";
+
+static const char *const leader_strings[] PROGMEM = {
+    leader_string0,
+    leader_string1,
+    leader_string2,
+    leader_string3,
+    leader_string4,
+    leader_string5,
+    leader_string6,
+};
+
+// Node 0 is the root.
+static const leader_node_t leader_nodes[] PROGMEM = {
+    {LEADER_ACTION_NONE, 0, 9},
+    {LGUI(KC_S), 9, 1},
+    {LGUI(LSFT(KC_Z)), 10, 0},
+    {LEADER_ACTION_NONE, 10, 1},
+    {LEADER_ACTION_NONE, 11, 1},
+    {LEADER_ACTION_NONE, 12, 1},
+    {LEADER_ACTION_NONE, 13, 1},
+    {LEADER_ACTION_NONE, 14, 1},
+    {LEADER_ACTION_NONE, 15, 1},
+    {LEADER_ACTION_NONE, 16, 1},
+    {LGUI(LSFT(KC_4)), 17, 0},
+    {LEADER_ACTION_STRING(0), 17, 0},
+    {LEADER_ACTION_STRING(1), 17, 0},
+    {LEADER_ACTION_STRING(2), 17, 0},
+    {LEADER_ACTION_STRING(3), 17, 0},
+    {LEADER_ACTION_STRING(4), 17, 0},
+    {LEADER_ACTION_STRING(5), 17, 0},
+    {LEADER_ACTION_STRING(6), 17, 0},
+};
+
+static const leader_edge_t leader_edges[] PROGMEM = {
+    {KC_S, 1},
+    {KC_R, 2},
+    {KC_A, 3},
+    {KC_F, 4},
+    {KC_W, 5},
+    {KC_N, 6},
+    {KC_E, 7},
+    {KC_L, 8},
+    {KC_G, 9},
+    {KC_S, 10},
+    {KC_R, 11},
+    {KC_A, 12},
+    {KC_A, 13},
+    {KC_E, 14},
+    {KC_Q, 15},
+    {KC_E, 16},
+    {KC_E, 17},
+};
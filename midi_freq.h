@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/*
+ * Frequency in Hz of every MIDI note, the same values
+ * compute_freq_for_midi_note returns with PITCH_STANDARD_A at 440 Hz:
+ *
+ *     440 * 2^((note - 69) / 12)
+ *
+ * Looking a note up avoids a soft-float pow() on every muse note change.
+ */
+// clang-format off
+static const float midi_note_freq_table[128] PROGMEM = {
+    8.1758f, 8.6620f, 9.1770f, 9.7227f, 10.3009f, 10.9134f, 11.5623f, 12.2499f, // 0-7
+    12.9783f, 13.7500f, 14.5676f, 15.4339f, 16.3516f, 17.3239f, 18.3540f, 19.4454f, // 8-15
+    20.6017f, 21.8268f, 23.1247f, 24.4997f, 25.9565f, 27.5000f, 29.1352f, 30.8677f, // 16-23
+    32.7032f, 34.6478f, 36.7081f, 38.8909f, 41.2034f, 43.6535f, 46.2493f, 48.9994f, // 24-31
+    51.9131f, 55.0000f, 58.2705f, 61.7354f, 65.4064f, 69.2957f, 73.4162f, 77.7817f, // 32-39
+    82.4069f, 87.3071f, 92.4986f, 97.9989f, 103.8262f, 110.0000f, 116.5409f, 123.4708f, // 40-47
+    130.8128f, 138.5913f, 146.8324f, 155.5635f, 164.8138f, 174.6141f, 184.9972f, 195.9977f, // 48-55
+    207.6523f, 220.0000f, 233.0819f, 246.9417f, 261.6256f, 277.1826f, 293.6648f, 311.1270f, // 56-63
+    329.6276f, 349.2282f, 369.9944f, 391.9954f, 415.3047f, 440.0000f, 466.1638f, 493.8833f, // 64-71
+    523.2511f, 554.3653f, 587.3295f, 622.2540f, 659.2551f, 698.4565f, 739.9888f, 783.9909f, // 72-79
+    830.6094f, 880.0000f, 932.3275f, 987.7666f, 1046.5023f, 1108.7305f, 1174.6591f, 1244.5079f, // 80-87
+    1318.5102f, 1396.9129f, 1479.9777f, 1567.9817f, 1661.2188f, 1760.0000f, 1864.6550f, 1975.5332f, // 88-95
+    2093.0045f, 2217.4610f, 2349.3181f, 2489.0159f, 2637.0205f, 2793.8259f, 2959.9554f, 3135.9635f, // 96-103
+    3322.4376f, 3520.0000f, 3729.3101f, 3951.0664f, 4186.0090f, 4434.9221f, 4698.6363f, 4978.0317f, // 104-111
+    5274.0409f, 5587.6517f, 5919.9108f, 6271.9270f, 6644.8752f, 7040.0000f, 7458.6202f, 7902.1328f, // 112-119
+    8372.0181f, 8869.8442f, 9397.2726f, 9956.0635f, 10548.0818f, 11175.3034f, 11839.8215f, 12543.8540f, // 120-127
+};
+// clang-format on
+
+/* Notes past 127 wrap around rather than clamp; callers keep to 0..127. */
+static inline float midi_note_freq(uint8_t note) {
+    union {
+        uint32_t bits;
+        float    freq;
+    } v = {.bits = pgm_read_dword(&midi_note_freq_table[note & 0x7F])};
+    return v.freq;
+}
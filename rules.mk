@@ -1,4 +1,4 @@
-SRC += muse.c
+SRC += scheduler.c
 
 TAP_DANCE_ENABLE = yes
 
@@ -6,4 +6,9 @@ DYNAMIC_TAPPING_TERM_ENABLE = yes
 
 LEADER_ENABLE = yes
 
-AUDIO_ENABLE = yes
\ No newline at end of file
+AUDIO_ENABLE = yes
+
+CONSOLE_ENABLE = yes
+
+DEBOUNCE_TYPE = custom
+SRC += debounce_adaptive.c
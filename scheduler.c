@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "scheduler.h"
+
+#ifndef SCHEDULER_CAPACITY
+#    define SCHEDULER_CAPACITY 8
+#endif
+
+typedef struct {
+    uint32_t             due;
+    scheduler_callback_t callback;
+    void                *arg;
+} scheduler_entry_t;
+
+static scheduler_entry_t scheduler_heap[SCHEDULER_CAPACITY];
+static uint8_t           scheduler_count = 0;
+
+// Due times wrap every 49 days, so they are compared by difference.
+static bool scheduler_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+static void scheduler_swap(uint8_t a, uint8_t b) {
+    scheduler_entry_t entry = scheduler_heap[a];
+    scheduler_heap[a]       = scheduler_heap[b];
+    scheduler_heap[b]       = entry;
+}
+
+static void scheduler_sift_up(uint8_t i) {
+    while (i && scheduler_before(scheduler_heap[i].due, scheduler_heap[(i - 1) / 2].due)) {
+        scheduler_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void scheduler_sift_down(uint8_t i) {
+    for (;;) {
+        uint8_t first = i;
+        uint8_t left  = 2 * i + 1;
+        uint8_t right = left + 1;
+        if (left < scheduler_count && scheduler_before(scheduler_heap[left].due, scheduler_heap[first].due)) {
+            first = left;
+        }
+        if (right < scheduler_count && scheduler_before(scheduler_heap[right].due, scheduler_heap[first].due)) {
+            first = right;
+        }
+        if (first == i) {
+            return;
+        }
+        scheduler_swap(i, first);
+        i = first;
+    }
+}
+
+static void scheduler_remove(uint8_t i) {
+    scheduler_heap[i] = scheduler_heap[--scheduler_count];
+    if (i < scheduler_count) {
+        scheduler_sift_up(i);
+        scheduler_sift_down(i);
+    }
+}
+
+static uint8_t scheduler_find(scheduler_callback_t callback) {
+    for (uint8_t i = 0; i < scheduler_count; i++) {
+        if (scheduler_heap[i].callback == callback) {
+            return i;
+        }
+    }
+    return SCHEDULER_CAPACITY;
+}
+
+bool scheduler_add(uint32_t now, uint32_t delay, scheduler_callback_t callback, void *arg) {
+    uint8_t i = scheduler_find(callback);
+    if (i == SCHEDULER_CAPACITY) {
+        if (scheduler_count == SCHEDULER_CAPACITY) {
+            return false;
+        }
+        i = scheduler_count++;
+    }
+    scheduler_heap[i] = (scheduler_entry_t){.due = now + delay, .callback = callback, .arg = arg};
+    scheduler_sift_up(i);
+    scheduler_sift_down(i);
+    return true;
+}
+
+void scheduler_cancel(scheduler_callback_t callback) {
+    uint8_t i = scheduler_find(callback);
+    if (i != SCHEDULER_CAPACITY) {
+        scheduler_remove(i);
+    }
+}
+
+bool scheduler_pending(scheduler_callback_t callback) {
+    return scheduler_find(callback) != SCHEDULER_CAPACITY;
+}
+
+void scheduler_run(uint32_t now) {
+    while (scheduler_count && !scheduler_before(now, scheduler_heap[0].due)) {
+        scheduler_entry_t entry = scheduler_heap[0];
+        scheduler_remove(0);
+        uint32_t delay = entry.callback(now, entry.arg);
+        // A non-zero delay replaces any time the callback set for itself.
+        if (delay) {
+            scheduler_add(now, delay, entry.callback, entry.arg);
+        }
+    }
+}
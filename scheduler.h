@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Deferred callbacks for the keymap, kept in a fixed-capacity min-heap by
+ * due time. A callback gets the time it runs at and its argument, and
+ * returns 0 when it is done or the delay in ms until it should run again.
+ * Each callback is scheduled at most once: adding one that is already
+ * pending moves it. Times are passed in rather than read, so the scheduler
+ * has no QMK dependencies and runs on a host with a virtual clock.
+ */
+typedef uint32_t (*scheduler_callback_t)(uint32_t now, void *arg);
+
+/* Runs callback delay ms after now. False if the heap is full. */
+bool scheduler_add(uint32_t now, uint32_t delay, scheduler_callback_t callback, void *arg);
+
+void scheduler_cancel(scheduler_callback_t callback);
+
+bool scheduler_pending(scheduler_callback_t callback);
+
+/* Runs every callback due at now. Returns at once when none is. */
+void scheduler_run(uint32_t now);
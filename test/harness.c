@@ -0,0 +1,969 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Replays scripted key streams through the keymap and checks what it sends.
+ * Each scenario runs in its own process on a freshly booted keyboard.
+ *
+ *   harness            run every scenario
+ *   harness NAME...    run the named ones
+ *   harness --bench    type a long pseudo-random stream and report the
+ *                      cost of each key event, then of macros, expansions,
+ *                      muse ticks and note lookups
+ *   harness --replay FILE [TAPPING_TERM]
+ *                      play back the key events in a DB_DUMP capture and
+ *                      report output latency and misresolved mod-taps
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host.h"
+#include "macros.h"
+#include "midi_freq.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+// Keys, by their place in the 5x12 grid.
+
+static keypos_t grid(uint8_t row, uint8_t col) {
+    return col < 6 ? (keypos_t){.row = row, .col = col} : (keypos_t){.row = row + 5, .col = col - 6};
+}
+
+#define K_GRV grid(0, 0)
+#define K_1 grid(0, 1)
+#define K_Q grid(1, 1)
+#define K_W grid(1, 2)
+#define K_E grid(1, 3)
+#define K_R grid(1, 4)
+#define K_T grid(1, 5)
+#define K_Y grid(1, 6)
+#define K_U grid(1, 7)
+#define K_I grid(1, 8)
+#define K_O grid(1, 9)
+#define K_P grid(1, 10)
+#define K_BSPC grid(1, 11)
+#define K_A grid(2, 1)
+#define K_S grid(2, 2)
+#define K_D grid(2, 3)
+#define K_F grid(2, 4)
+#define K_G grid(2, 5)
+#define K_H grid(2, 6)
+#define K_J grid(2, 7)
+#define K_K grid(2, 8)
+#define K_L grid(2, 9)
+#define K_SCLN grid(2, 10)
+#define K_ENT grid(2, 11)
+#define K_Z grid(3, 1)
+#define K_C grid(3, 3)
+#define K_V grid(3, 4)
+#define K_N grid(3, 6)
+#define K_M grid(3, 7)
+#define K_COMM grid(3, 8)
+#define K_LCTL grid(4, 1)
+#define K_LOWER grid(4, 4)
+#define K_SPC grid(4, 5)
+#define K_RAISE grid(4, 7)
+#define K_LEFT grid(4, 8)
+#define K_DOWN grid(4, 9)
+
+static void press(keypos_t key) {
+    host_switch(key, true);
+    host_idle(1);
+}
+
+/* Opening a switch only registers once the debounce window has passed. */
+static void release(keypos_t key) {
+    host_switch(key, false);
+    host_idle(1);
+}
+
+static void tap(keypos_t key) {
+    press(key);
+    host_idle(30);
+    release(key);
+    host_idle(30);
+}
+
+static void encoder(bool clockwise, uint8_t detents) {
+    while (detents--) {
+        encoder_update_user(0, clockwise);
+    }
+}
+
+// Checks
+
+static int failures;
+
+#define EXPECT_REPORTS(expected) expect(__LINE__, "reports", host_reports(), expected)
+#define EXPECT_TEXT(expected) expect(__LINE__, "text", host_text(), expected)
+
+static void expect(int line, const char *what, const char *actual, const char *expected) {
+    if (strcmp(actual, expected)) {
+        fprintf(stderr, "    harness.c:%d: %s\n      expected \"%s\"\n      got      \"%s\"\n", line, what, expected, actual);
+        failures++;
+    }
+}
+
+#define EXPECT(condition) expect_true(__LINE__, #condition, condition)
+
+static void expect_true(int line, const char *condition, bool value) {
+    if (!value) {
+        fprintf(stderr, "    harness.c:%d: %s\n", line, condition);
+        failures++;
+    }
+}
+
+static unsigned count_of(const char *haystack, const char *needle) {
+    unsigned count = 0;
+    for (const char *p = haystack; (p = strstr(p, needle)); p += strlen(needle)) {
+        count++;
+    }
+    return count;
+}
+
+// Replay
+
+/*
+ * Plays back a DB_DUMP console capture: every "trace: N records" block in
+ * the file, in order, with each record's delta run on the virtual clock.
+ * Latency is measured from the switch closing (so it includes debounce) to
+ * the first report that sends the key's basic or tap keycode, matching
+ * presses of the same keycode oldest first. A press with no such report
+ * within REPLAY_WINDOW ms, or before its key is pressed again, sent nothing
+ * of its own.
+ *
+ * Whether a mod-tap was meant as a hold is read from the trace: it was if
+ * another key went down and came back up while it was held. It was sent as
+ * a hold if its tap keycode never went out.
+ */
+#define REPLAY_WINDOW 1000
+
+typedef struct {
+    keypos_t key;
+    bool     pressed;
+    uint16_t delta;
+} replay_record_t;
+
+typedef struct {
+    keypos_t key;
+    uint32_t at;
+    uint8_t  keycode; // KC_NO when the press is not measured
+    bool     mod_tap;
+    bool     meant_hold;
+    bool     done;
+} replay_press_t;
+
+typedef struct {
+    uint16_t *latency;
+    unsigned  count;
+    unsigned  silent;
+} replay_class_t;
+
+static replay_record_t *replay_records;
+static unsigned         replay_count;
+static replay_press_t  *replay_presses;
+static unsigned         replay_first_pending;
+static uint32_t         replay_seen[256];
+static replay_class_t   replay_plain, replay_mod_tap;
+static unsigned         replay_meant_holds, replay_false_holds, replay_false_taps;
+
+static int replay_hex(char c) {
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'F' ? c - 'A' + 10 : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/* Appends the records of every trace block in text. */
+static bool replay_parse(const char *text) {
+    for (const char *block = text; (block = strstr(block, "trace: "));) {
+        unsigned records = strtoul(block + 7, NULL, 10);
+        block            = strchr(block, '\n');
+        if (!block) {
+            break;
+        }
+        if (!records) {
+            continue;
+        }
+        replay_records = realloc(replay_records, (replay_count + records) * sizeof(*replay_records));
+        for (unsigned i = 0; i < records; i++) {
+            uint8_t bytes[4];
+            for (uint8_t b = 0; b < 4; b++) {
+                while (*block == ' ' || *block == '\n' || *block == '\r') {
+                    block++;
+                }
+                if (replay_hex(block[0]) < 0 || replay_hex(block[1]) < 0) {
+                    fprintf(stderr, "replay: trace ends after %u of %u records\n", i, records);
+                    return false;
+                }
+                bytes[b] = replay_hex(block[0]) << 4 | replay_hex(block[1]);
+                block += 2;
+            }
+            keypos_t key = {.row = bytes[0] >> 4, .col = bytes[0] & 0x0F};
+            if (key.row >= MATRIX_ROWS || key.col >= MATRIX_COLS) {
+                fprintf(stderr, "replay: record %u is outside the matrix\n", replay_count);
+                return false;
+            }
+            replay_records[replay_count++] = (replay_record_t){key, bytes[1] & 0x01, bytes[2] | bytes[3] << 8};
+        }
+    }
+    return true;
+}
+
+/* The keycode a press resolves to under the current layers, as QMK's layer
+   walk finds it. */
+static uint16_t replay_keycode(keypos_t key) {
+    layer_state_t layers = layer_state | default_layer_state;
+    for (int8_t layer = 31; layer > 0; layer--) {
+        if (layers & ((layer_state_t)1 << layer)) {
+            uint16_t keycode = keymap_key_to_keycode(layer, key);
+            if (keycode != KC_TRNS) {
+                return keycode;
+            }
+        }
+    }
+    return keymap_key_to_keycode(0, key);
+}
+
+/* Whether the press at index had another key go down and up inside it. */
+static bool replay_meant_hold(unsigned index) {
+    keypos_t key = replay_records[index].key;
+    for (unsigned i = index + 1; i < replay_count && !KEYEQ(replay_records[i].key, key); i++) {
+        if (!replay_records[i].pressed) {
+            continue;
+        }
+        for (unsigned j = i + 1; j < replay_count; j++) {
+            if (KEYEQ(replay_records[j].key, key)) {
+                break;
+            }
+            if (KEYEQ(replay_records[j].key, replay_records[i].key)) {
+                if (!replay_records[j].pressed) {
+                    return true;
+                }
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+static void replay_settle(replay_press_t *press, bool sent) {
+    replay_class_t *class = press->mod_tap ? &replay_mod_tap : &replay_plain;
+    press->done           = true;
+    if (sent) {
+        class->latency[class->count++] = host_now() - press->at;
+    } else if (!press->mod_tap) {
+        class->silent++;
+    }
+    if (press->mod_tap && press->meant_hold != !sent) {
+        press->meant_hold ? replay_false_taps++ : replay_false_holds++;
+    }
+}
+
+/* Matches reports sent so far to the presses still waiting on them. */
+static void replay_check(unsigned pressed) {
+    for (unsigned i = replay_first_pending; i < pressed; i++) {
+        replay_press_t *press = &replay_presses[i];
+        if (press->done) {
+            continue;
+        }
+        if (host_key_sends(press->keycode) > replay_seen[press->keycode]) {
+            replay_seen[press->keycode]++;
+            replay_settle(press, true);
+        } else if (host_now() - press->at >= REPLAY_WINDOW) {
+            replay_settle(press, false);
+        }
+    }
+    while (replay_first_pending < pressed && replay_presses[replay_first_pending].done) {
+        replay_first_pending++;
+    }
+}
+
+static void replay_wait(uint32_t ms, unsigned pressed) {
+    while (ms && replay_first_pending < pressed) {
+        host_idle(1);
+        replay_check(pressed);
+        ms--;
+    }
+    host_idle(ms);
+}
+
+static int replay_compare(const void *a, const void *b) {
+    return *(const uint16_t *)a - *(const uint16_t *)b;
+}
+
+static void replay_print(const char *name, replay_class_t *class) {
+    if (!class->count) {
+        printf("  %s: none sent\n", name);
+        return;
+    }
+    uint32_t sum = 0;
+    for (unsigned i = 0; i < class->count; i++) {
+        sum += class->latency[i];
+    }
+    qsort(class->latency, class->count, sizeof(class->latency[0]), replay_compare);
+    printf("  %s: %u sent, latency mean %.1f ms, median %u, 95th %u, worst %u\n", name, class->count, (double)sum / class->count, class->latency[class->count / 2], class->latency[class->count * 95 / 100], class->latency[class->count - 1]);
+}
+
+/* Boots a fresh keyboard and plays the parsed records through it. */
+static void replay_run(uint16_t term) {
+    free(replay_presses);
+    free(replay_plain.latency);
+    free(replay_mod_tap.latency);
+    replay_presses       = calloc(replay_count, sizeof(*replay_presses));
+    replay_plain         = (replay_class_t){.latency = calloc(replay_count, sizeof(uint16_t))};
+    replay_mod_tap       = (replay_class_t){.latency = calloc(replay_count, sizeof(uint16_t))};
+    replay_first_pending = 0;
+    replay_meant_holds = replay_false_holds = replay_false_taps = 0;
+    host_boot();
+    host_idle(1000);
+    host_output_clear();
+    if (term) {
+        g_tapping_term = term;
+    }
+    unsigned pressed = 0;
+    for (unsigned i = 0; i < replay_count; i++) {
+        replay_record_t *record = &replay_records[i];
+        replay_wait(record->delta, pressed);
+        if (record->pressed) {
+            // Pressing a key again ends the wait on its last press.
+            for (unsigned j = replay_first_pending; j < pressed; j++) {
+                if (!replay_presses[j].done && KEYEQ(replay_presses[j].key, record->key)) {
+                    replay_settle(&replay_presses[j], false);
+                }
+            }
+            uint16_t        keycode = replay_keycode(record->key);
+            replay_press_t *press   = &replay_presses[pressed++];
+            *press                  = (replay_press_t){.key = record->key, .at = host_now(), .keycode = keycode};
+            if (IS_QK_MOD_TAP(keycode)) {
+                press->keycode    = QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
+                press->mod_tap    = true;
+                press->meant_hold = replay_meant_hold(i);
+                replay_meant_holds += press->meant_hold;
+            } else if (keycode > 0xFF || IS_MODIFIER_KEYCODE(keycode)) {
+                press->keycode = KC_NO;
+            }
+            // A measured press only counts reports sent after it.
+            bool waiting = false;
+            for (unsigned j = replay_first_pending; j + 1 < pressed; j++) {
+                waiting |= !replay_presses[j].done && replay_presses[j].keycode == press->keycode;
+            }
+            if (!waiting) {
+                replay_seen[press->keycode] = host_key_sends(press->keycode);
+            }
+            press->done = press->keycode == KC_NO;
+        }
+        host_switch(record->key, record->pressed);
+    }
+    for (unsigned i = 0; i < replay_count; i++) {
+        host_switch(replay_records[i].key, false);
+    }
+    replay_wait(REPLAY_WINDOW, pressed);
+}
+
+static int replay(const char *path, uint16_t term) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    size_t size = 0, length = 0;
+    char  *text = NULL;
+    do {
+        text = realloc(text, size += 1 << 16);
+        length += fread(text + length, 1, size - length - 1, file);
+    } while (length == size - 1);
+    text[length] = '\0';
+    fclose(file);
+    bool parsed = replay_parse(text);
+    free(text);
+    if (!parsed || !replay_count) {
+        fprintf(stderr, "replay: no trace records in %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t span = 0;
+    for (unsigned i = 0; i < replay_count; i++) {
+        span += replay_records[i].delta;
+    }
+    replay_run(term);
+    printf("%u records over %.1f s, tapping term %u ms\n", replay_count, span / 1000.0, g_tapping_term);
+    replay_print("plain keys", &replay_plain);
+    printf("  plain keys that sent nothing of their own: %u\n", replay_plain.silent);
+    replay_print("mod-tap taps", &replay_mod_tap);
+    printf("  mod-taps: %u meant as holds; %u taps sent as holds, %u holds sent as taps\n", replay_meant_holds, replay_false_holds, replay_false_taps);
+    return EXIT_SUCCESS;
+}
+
+// Scenarios
+
+static void plain_letters(void) {
+    tap(K_Q);
+    tap(K_W);
+    EXPECT_REPORTS("+q -q +w -w");
+}
+
+static void home_row_tap(void) {
+    tap(K_F);
+    host_idle(300);
+    EXPECT_REPORTS("+f -f");
+}
+
+static void home_row_hold(void) {
+    press(K_F);
+    host_idle(TAPPING_TERM + 50);
+    tap(K_H);
+    release(K_F);
+    host_idle(30);
+    EXPECT_REPORTS("+lsft +h -h -lsft");
+    EXPECT_TEXT("H");
+}
+
+static void streak_types_through_mods(void) {
+    tap(K_Q);
+    press(K_F);
+    host_idle(TAPPING_TERM + 50);
+    release(K_F);
+    host_idle(30);
+    EXPECT_TEXT("qf");
+}
+
+static void streak_ends_at_space(void) {
+    tap(K_Q);
+    press(K_SPC);
+    host_idle(20);
+    release(K_SPC);
+    host_idle(10);
+    press(K_F);
+    host_idle(TAPPING_TERM + 50);
+    tap(K_H);
+    release(K_F);
+    host_idle(30);
+    EXPECT_TEXT("q H");
+}
+
+static void tap_dance_single(void) {
+    tap(K_GRV);
+    host_idle(TAPPING_TERM + 50);
+    EXPECT_TEXT("`");
+}
+
+static void tap_dance_double(void) {
+    tap(K_GRV);
+    tap(K_GRV);
+    host_idle(TAPPING_TERM + 50);
+    EXPECT_TEXT("~");
+}
+
+static void tap_dance_with_ctrl(void) {
+    press(K_LCTL);
+    tap(K_GRV);
+    tap(K_GRV);
+    host_idle(TAPPING_TERM + 50);
+    release(K_LCTL);
+    host_idle(30);
+    EXPECT_TEXT("<lctl+lsft+grv>");
+}
+
+static void chord_esc(void) {
+    press(K_J);
+    press(K_K);
+    host_idle(30);
+    release(K_J);
+    release(K_K);
+    host_idle(30);
+    EXPECT_REPORTS("+esc -esc");
+}
+
+static void chord_key_keeps_order(void) {
+    press(K_LCTL);
+    press(K_M);
+    release(K_LCTL);
+    host_idle(60);
+    release(K_M);
+    host_idle(30);
+    EXPECT_REPORTS("+lctl +m -lctl -m");
+}
+
+static void chord_after_chord(void) {
+    press(K_J);
+    press(K_K);
+    host_idle(30);
+    release(K_J);
+    host_idle(30);
+    press(K_D);
+    press(K_F);
+    host_idle(30);
+    release(K_K);
+    host_idle(30);
+    EXPECT_REPORTS("+esc -esc +tab");
+    release(K_D);
+    release(K_F);
+    host_idle(30);
+    EXPECT_REPORTS("+esc -esc +tab -tab");
+}
+
+/* The press lands on an even ms, so its timestamp is a ms ahead of the clock. */
+static void chord_on_even_ms(void) {
+    host_idle(host_now() & 1 ? 0 : 1);
+    press(K_D);
+    host_idle(CHORD_TERM / 2);
+    press(K_F);
+    host_idle(30);
+    release(K_D);
+    release(K_F);
+    host_idle(30);
+    EXPECT_REPORTS("+tab -tab");
+}
+
+static void chord_key_alone(void) {
+    press(K_J);
+    host_idle(60);
+    release(K_J);
+    host_idle(TAPPING_TERM);
+    EXPECT_TEXT("j");
+}
+
+/* A key sent in the ms it was pressed lands in the 0 ms bucket, whichever
+   way its timestamp was rounded. */
+static void latency_instant_keys(void) {
+    debug_enable = true;
+    host_idle(1);
+    for (uint8_t i = 0; i < 40; i++) {
+        press(K_Q);
+        host_idle(i % 2 ? 29 : 30);
+        release(K_Q);
+        host_idle(30);
+    }
+    host_idle(INSTR_REPORT_INTERVAL);
+    EXPECT(strstr(host_console(), "lat plain: 40 0 0 0 0 0 0 0 0 0\n"));
+}
+
+static void lower_layer(void) {
+    press(K_LOWER);
+    tap(K_G);
+    release(K_LOWER);
+    host_idle(30);
+    tap(K_G);
+    EXPECT_TEXT("(g");
+}
+
+static void expansion(void) {
+    tap(K_SCLN);
+    host_idle(200);
+    tap(K_T);
+    host_idle(200);
+    tap(K_Y);
+    host_idle(500);
+    EXPECT_TEXT("Thank you!");
+}
+
+/* A tap dance between the keys of an abbreviation breaks it up. */
+static void expansion_cleared_by_tap_dance(void) {
+    tap(K_SCLN);
+    host_idle(200);
+    tap(K_T);
+    host_idle(200);
+    tap(K_GRV);
+    host_idle(TAPPING_TERM + 50);
+    tap(K_Y);
+    host_idle(200);
+    EXPECT_TEXT(";t`y");
+}
+
+/* macros.h is packed by gen_tables.py; the keymap decodes it as it types. */
+static void packed_macros_typed(void) {
+    press(K_LOWER);
+    press(K_RAISE);
+    tap(K_J);
+    tap(K_K);
+    tap(K_M);
+    release(K_RAISE);
+    release(K_LOWER);
+    host_idle(300 * MACRO_CHAR_DELAY);
+    EXPECT_TEXT(MACRO_STRING1 "<lctl+a>select all, then <end>end" "waited");
+}
+
+static void encoder_pages(void) {
+    encoder(true, 1);
+    host_idle(200);
+    EXPECT_TEXT("<pgdn>");
+}
+
+/* A full backlog plus a fast spin must not wrap the pending count around. */
+static void encoder_pages_saturate(void) {
+    encoder(true, 40);
+    host_idle(1);
+    encoder(true, 100);
+    host_idle(500);
+    EXPECT(count_of(host_text(), "<pgdn>") == 1 + ENCODER_PAGES_MAX);
+    EXPECT(count_of(host_text(), "<pgup>") == 0);
+}
+
+/* Page taps still pending when muse mode turns on are dropped, not sent
+   when it turns off. */
+static void encoder_pages_dropped_by_muse(void) {
+    encoder(true, 20);
+    host_idle(2);
+    dip_switch_update_user(1, true);
+    host_idle(5000);
+    host_output_clear();
+    dip_switch_update_user(1, false);
+    host_idle(5000);
+    EXPECT(count_of(host_text(), "<pgdn>") == 0);
+}
+
+/* Detents NAV_REPEAT_RATE ms apart page once each; at the floor gap they
+   page NAV_REPEAT_RATE / NAV_REPEAT_FLOOR times each, after a first detent
+   that follows a pause. */
+static void encoder_accelerates(void) {
+    for (uint8_t i = 0; i < 4; i++) {
+        host_idle(NAV_REPEAT_RATE);
+        encoder(true, 1);
+    }
+    host_idle(100);
+    EXPECT(count_of(host_text(), "<pgdn>") == 4);
+    host_output_clear();
+    for (uint8_t i = 0; i < 4; i++) {
+        host_idle(NAV_REPEAT_FLOOR);
+        encoder(true, 1);
+    }
+    host_idle(100);
+    EXPECT(count_of(host_text(), "<pgdn>") == 1 + 3 * (NAV_REPEAT_RATE / NAV_REPEAT_FLOOR));
+}
+
+static void nav_repeat(void) {
+    press(K_LEFT);
+    host_idle(1000);
+    release(K_LEFT);
+    host_idle(100);
+    EXPECT(count_of(host_text(), "<left>") >= 5);
+}
+
+/* Once a home-row mod's term has settled, tapping it at the same speed
+   changes nothing that is stored, so nothing is written. */
+static void hrm_steady_taps_not_saved(void) {
+    uint32_t writes = 0;
+    for (uint8_t minute = 0; minute < 8; minute++) {
+        // The first three minutes let the term settle and be saved.
+        if (minute == 3) {
+            writes = host_eeprom_writes();
+        }
+        for (uint8_t i = 0; i < 20; i++) {
+            press(K_F);
+            host_idle(32); // held 38 ms, mid-way through a 4 ms step
+            release(K_F);
+            host_idle(300);
+        }
+        host_idle(HRM_TERM_SAVE_INTERVAL);
+    }
+    EXPECT(host_eeprom_writes() == writes);
+}
+
+/* Typing never writes the heatmap; suspending the keyboard does. */
+static void heatmap_saved_on_suspend(void) {
+    uint32_t writes = host_eeprom_writes();
+    for (uint8_t i = 0; i < 20; i++) {
+        tap(K_Q);
+    }
+    host_idle(20 * 60 * 1000);
+    EXPECT(host_eeprom_writes() == writes);
+    suspend_power_down_user();
+    EXPECT(host_eeprom_writes() > writes);
+}
+
+static void muse_plays_on_dip(void) {
+    dip_switch_update_user(1, true);
+    host_idle(3000);
+    EXPECT(host_notes() > 0);
+    dip_switch_update_user(1, false);
+    host_idle(100);
+    EXPECT(host_notes() == 0);
+}
+
+/* The DIP switch's _ADJUST layer is not a held key: the encoder still moves
+   the tempo. */
+static void muse_encoder_under_dip_layer(void) {
+    dip_switch_update_user(0, true);
+    dip_switch_update_user(1, true);
+    uint16_t tempo  = muse_tempo;
+    uint8_t  offset = muse_offset;
+    encoder(true, 1);
+    host_idle(10);
+    EXPECT(muse_tempo == tempo + 1);
+    press(K_RAISE);
+    host_idle(100); // slow enough that the detent counts once
+    encoder(true, 1);
+    host_idle(10);
+    release(K_RAISE);
+    EXPECT(muse_offset == offset + 1);
+}
+
+/* A DB_DUMP trace played back types what was typed, and a mod-tap tapped
+   on its own is neither meant nor sent as a hold. */
+static void replay_round_trip(void) {
+    tap(K_W);
+    tap(K_E);
+    host_idle(300);
+    tap(K_F);
+    host_idle(300);
+    press(K_LOWER);
+    press(K_RAISE);
+    tap(K_E); // DB_DUMP
+    release(K_RAISE);
+    release(K_LOWER);
+    EXPECT(replay_parse(host_console()));
+    EXPECT(replay_count == 9);
+
+    replay_run(0);
+    EXPECT(!strncmp(host_text(), "wef", 3));
+    EXPECT(replay_plain.count == 2 && replay_plain.silent == 0);
+    EXPECT(replay_plain.latency[0] <= DEBOUNCE + 1 && replay_plain.latency[1] <= DEBOUNCE + 1);
+    EXPECT(replay_mod_tap.count == 1);
+    EXPECT(replay_meant_holds == 0 && replay_false_holds == 0 && replay_false_taps == 0);
+}
+
+/* F held over a whole J tap was meant as a hold. Under the default term
+   it is released in time to be sent as a tap; under a 60 ms term it is
+   not. */
+static void replay_misresolved_hold(void) {
+    // F down, J down 20 ms later, J up, F up, each 30 ms after the last.
+    EXPECT(replay_parse("trace: 4 records\n240100007101140071001E0024001E00\n"));
+    replay_run(0);
+    EXPECT(replay_meant_holds == 1 && replay_false_taps == 1 && replay_false_holds == 0);
+    replay_run(60);
+    EXPECT(replay_meant_holds == 1 && replay_false_taps == 0 && replay_false_holds == 0);
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} scenarios[] = {
+#define SCENARIO(name) {#name, name}
+    SCENARIO(plain_letters),
+    SCENARIO(home_row_tap),
+    SCENARIO(home_row_hold),
+    SCENARIO(streak_types_through_mods),
+    SCENARIO(streak_ends_at_space),
+    SCENARIO(tap_dance_single),
+    SCENARIO(tap_dance_double),
+    SCENARIO(tap_dance_with_ctrl),
+    SCENARIO(chord_esc),
+    SCENARIO(chord_key_keeps_order),
+    SCENARIO(chord_after_chord),
+    SCENARIO(chord_on_even_ms),
+    SCENARIO(chord_key_alone),
+    SCENARIO(latency_instant_keys),
+    SCENARIO(lower_layer),
+    SCENARIO(expansion),
+    SCENARIO(expansion_cleared_by_tap_dance),
+    SCENARIO(packed_macros_typed),
+    SCENARIO(encoder_pages),
+    SCENARIO(encoder_pages_saturate),
+    SCENARIO(encoder_accelerates),
+    SCENARIO(encoder_pages_dropped_by_muse),
+    SCENARIO(nav_repeat),
+    SCENARIO(hrm_steady_taps_not_saved),
+    SCENARIO(heatmap_saved_on_suspend),
+    SCENARIO(muse_plays_on_dip),
+    SCENARIO(muse_encoder_under_dip_layer),
+    SCENARIO(replay_round_trip),
+    SCENARIO(replay_misresolved_hold),
+#undef SCENARIO
+};
+
+/* Boots a fresh keyboard in a child process and runs one scenario on it. */
+static bool run_scenario(unsigned index) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        host_boot();
+        host_idle(1000);
+        host_output_clear();
+        scenarios[index].run();
+        exit(failures ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    bool passed = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+    printf("%s %s\n", passed ? "ok  " : "FAIL", scenarios[index].name);
+    return passed;
+}
+
+// Benchmark
+
+static uint32_t bench_seed = 0x2545F491;
+
+static uint32_t bench_random(uint32_t range) {
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+    return bench_seed % range;
+}
+
+static uint64_t bench_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+static double bench_idle_scan_ns(void) {
+    host_idle(1000);
+    host_cost_enable(true);
+    host_idle(5000);
+    host_cost_t cost = host_cost();
+    host_cost_enable(false);
+    return (double)cost.scan_ns / cost.scans;
+}
+
+/* A macro character costs what its scan takes over an idle scan, less the
+   stand-in's report logging: decoding it and building its report. */
+static void bench_macros(double idle_ns) {
+    host_cost_enable(true);
+    for (unsigned round = 0; round < 50; round++) {
+        press(K_LOWER);
+        press(K_RAISE);
+        for (uint8_t i = 0; i < MACRO_QUEUE_DEPTH; i++) {
+            tap(K_J);
+        }
+        release(K_RAISE);
+        release(K_LOWER);
+        host_idle(MACRO_QUEUE_DEPTH * sizeof(MACRO_STRING1) * MACRO_CHAR_DELAY + 100);
+        host_output_clear();
+    }
+    host_cost_t cost = host_cost();
+    host_cost_enable(false);
+    printf("  %.0f ns per macro character typed, over %u\n", (double)(cost.report_scan_ns - cost.report_ns) / cost.report_scans - idle_ns, cost.report_scans);
+}
+
+/* An expansion through the keymap's batched sender, against the same keys
+   sent a report per key change the way send_string_P does. */
+static void bench_expansion(void) {
+    const unsigned rounds = 200;
+    uint64_t       batched_ns = 0, single_ns = 0;
+    uint32_t       batched_reports = 0, single_reports = 0, erased = 0;
+    size_t         length = 0;
+    for (unsigned round = 0; round < rounds; round++) {
+        tap(K_SCLN);
+        tap(K_I);
+        tap(K_I);
+        tap(K_R);
+        host_output_clear();
+        host_cost_enable(true);
+        tap(K_C);
+        host_cost_t cost = host_cost();
+        batched_ns += cost.event_ns - cost.report_ns;
+        batched_reports += cost.reports;
+        erased = count_of(host_reports(), "+bspc");
+
+        char text[64];
+        snprintf(text, sizeof(text), "%s", host_text());
+        length = strlen(text);
+        host_output_clear();
+        host_cost_enable(true);
+        uint64_t start = bench_ns();
+        for (uint32_t i = 0; i < erased; i++) {
+            tap_code(KC_BSPC);
+        }
+        send_string_P(text);
+        single_ns += bench_ns() - start;
+        cost = host_cost();
+        host_cost_enable(false);
+        single_ns -= cost.report_ns;
+        single_reports += cost.reports;
+        tap(K_ENT);
+        host_output_clear();
+    }
+    printf("expansion of %zu characters over %u erased\n", length, erased);
+    printf("  batched: %u reports, %.0f ns\n", batched_reports / rounds, (double)batched_ns / rounds);
+    printf("  per key: %u reports, %.0f ns\n", single_reports / rounds, (double)single_ns / rounds);
+}
+
+/* Ticks that start or stop a note, including the ones that compose the next bar. */
+static void bench_muse(double idle_ns) {
+    dip_switch_update_user(1, true);
+    host_idle(1000);
+    host_cost_enable(true);
+    host_idle(60000);
+    host_cost_t cost = host_cost();
+    host_cost_enable(false);
+    dip_switch_update_user(1, false);
+    host_idle(100);
+    printf("muse: %.0f ns per tick over %u ticks playing %u note changes\n",
+           (double)cost.note_scan_ns / cost.note_scans - idle_ns, cost.note_scans, cost.notes);
+}
+
+/* What muse_play paid per note before midi_freq.h: the frequency from pow(). */
+static void bench_note_freq(void) {
+    const unsigned notes = 1000000;
+    volatile float sink;
+    uint64_t       start = bench_ns();
+    for (unsigned i = 0; i < notes; i++) {
+        sink = midi_note_freq(i % 128);
+    }
+    uint64_t table_ns = bench_ns() - start;
+    start             = bench_ns();
+    for (unsigned i = 0; i < notes; i++) {
+        sink = 440.0f * pow(2.0, ((int)(i % 128) - 69) / 12.0);
+    }
+    uint64_t pow_ns = bench_ns() - start;
+    (void)sink;
+    printf("note frequency: %.1f ns from the table, %.1f ns from pow()\n", (double)table_ns / notes, (double)pow_ns / notes);
+}
+
+static int bench(void) {
+    static const uint8_t rows[] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 4};
+    static const uint8_t cols[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 1, 2, 3, 4, 5, 6, 7, 8, 9, 1, 2, 3, 4, 5, 6, 7, 8, 5};
+    const unsigned       taps   = 20000;
+
+    host_boot();
+    host_idle(1000);
+    host_cost_enable(true);
+    uint32_t start = host_now();
+    for (unsigned i = 0; i < taps; i++) {
+        unsigned key = bench_random(ARRAY_SIZE(rows));
+        press(grid(rows[key], cols[key]));
+        host_idle(20 + bench_random(60));
+        release(grid(rows[key], cols[key]));
+        host_idle(40 + bench_random(120));
+        if (i % 64 == 0) {
+            host_output_clear();
+        }
+    }
+    host_cost_t cost = host_cost();
+    host_cost_enable(false);
+
+    double event_ns = cost.events ? (double)cost.event_ns / cost.events : 0;
+    printf("%u key events over %.1f s of typing\n", cost.events, (host_now() - start) / 1000.0);
+    printf("  %.0f ns per event, worst %llu ns, %.0f events/s of CPU\n", event_ns, (unsigned long long)cost.worst_event_ns, event_ns ? 1e9 / event_ns : 0);
+    printf("  %.0f ns per scan over %u scans\n", cost.scans ? (double)cost.scan_ns / cost.scans : 0, cost.scans);
+
+    double idle_ns = bench_idle_scan_ns();
+    bench_macros(idle_ns);
+    bench_expansion();
+    bench_muse(idle_ns);
+    bench_note_freq();
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        return bench();
+    }
+    if (argc > 2 && !strcmp(argv[1], "--replay")) {
+        return replay(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+    }
+    unsigned run = 0, failed = 0;
+    for (unsigned i = 0; i < ARRAY_SIZE(scenarios); i++) {
+        bool wanted = argc == 1;
+        for (int arg = 1; arg < argc; arg++) {
+            wanted |= !strcmp(argv[arg], scenarios[i].name);
+        }
+        if (wanted) {
+            run++;
+            failed += !run_scenario(i);
+        }
+    }
+    printf("%u of %u scenarios passed\n", run - failed, run);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Controls for the host build of the keymap (qmk_stub.c). Time only moves
+ * when the harness says so: host_idle runs one matrix scan per virtual ms,
+ * with the keymap's debounce, tapping, tap dance, leader and scan hooks in
+ * the order QMK runs them.
+ */
+
+#pragma once
+
+#include "quantum.h"
+
+/* Resets the clock and EEPROM, then runs the keymap's init hooks. */
+void host_boot(void);
+
+uint32_t host_now(void);
+
+/* Scans the matrix once per ms for ms ms. */
+void host_idle(uint32_t ms);
+
+/* Closes or opens a switch; the keymap sees it from the next scan. */
+void host_switch(keypos_t key, bool closed);
+
+/*
+ * HID reports sent since the last clear, as space-separated changes: "+a"
+ * and "-a" for a key going down and up, "+lsft" and "-lsft" for modifiers.
+ */
+const char *host_reports(void);
+
+/*
+ * The same reports read as typing on a US layout: printable keys append
+ * their character, Backspace deletes one, Enter is "\n" and anything else,
+ * or any key pressed with Ctrl, Alt or GUI, appears as "<lctl+lalt+name>".
+ */
+const char *host_text(void);
+
+void host_output_clear(void);
+
+/* Reports that have put key down since the program started. */
+uint32_t host_key_sends(uint8_t key);
+
+/* Everything the keymap printed to the console. */
+const char *host_console(void);
+
+/* EEPROM bytes changed since boot. */
+uint32_t host_eeprom_writes(void);
+
+/* Notes currently sounding. */
+int host_notes(void);
+
+/* Per-event processing cost, measured around each action_exec from a scan.
+   report_ns is the stand-in's own time logging reports; report_scan_ns
+   covers the scans that sent any, note_scan_ns those that started or
+   stopped a note. */
+typedef struct {
+    uint32_t events;
+    uint64_t event_ns;
+    uint64_t worst_event_ns;
+    uint32_t scans;
+    uint64_t scan_ns;
+    uint32_t reports;
+    uint64_t report_ns;
+    uint32_t report_scans;
+    uint64_t report_scan_ns;
+    uint32_t notes;
+    uint32_t note_scans;
+    uint64_t note_scan_ns;
+} host_cost_t;
+
+void        host_cost_enable(bool enable);
+host_cost_t host_cost(void);
@@ -0,0 +1,9 @@
+// Macros the host build packs and types; a stand-in for a private macros.h.
+
+#define MACRO_STRING1 "the quick brown fox jumps over the lazy dog, then the quick brown fox naps"
+#define MACRO_STRING2 SS_LCTL("a") "select all, then " \
+                      SS_TAP(X_END) "end"
+#define MACRO_STRING3 "meet at noon; bring the notes from the last meeting"
+#define MACRO_STRING4 ""
+#define MACRO_STRING5 "wait" SS_DELAY(20) "ed"
+#define MACRO_STRING6 "Regards, and thanks again for the review of the scheduler notes"
@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * The part of QMK's API this keymap uses, for a host build. Keycode values,
+ * struct layouts and macros follow QMK; the functions are implemented in
+ * qmk_stub.c against a virtual clock and a recorded HID report stream.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// progmem.h
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) __extension__({ uint32_t dword_; memcpy(&dword_, (p), sizeof(dword_)); dword_; })
+#define pgm_read_ptr(p) (*(void *const *)(p))
+#define memcpy_P(dest, src, n) memcpy(dest, src, n)
+#define strlen_P(s) strlen(s)
+
+// Preonic rev3 matrix: the grid's right half is wired as rows 5-9.
+
+#define MATRIX_ROWS 10
+#define MATRIX_COLS 6
+
+// clang-format off
+#define LAYOUT_preonic_grid( \
+    k00, k01, k02, k03, k04, k05, k06, k07, k08, k09, k0a, k0b, \
+    k10, k11, k12, k13, k14, k15, k16, k17, k18, k19, k1a, k1b, \
+    k20, k21, k22, k23, k24, k25, k26, k27, k28, k29, k2a, k2b, \
+    k30, k31, k32, k33, k34, k35, k36, k37, k38, k39, k3a, k3b, \
+    k40, k41, k42, k43, k44, k45, k46, k47, k48, k49, k4a, k4b  \
+) { \
+    { k00, k01, k02, k03, k04, k05 }, \
+    { k10, k11, k12, k13, k14, k15 }, \
+    { k20, k21, k22, k23, k24, k25 }, \
+    { k30, k31, k32, k33, k34, k35 }, \
+    { k40, k41, k42, k43, k44, k45 }, \
+    { k06, k07, k08, k09, k0a, k0b }, \
+    { k16, k17, k18, k19, k1a, k1b }, \
+    { k26, k27, k28, k29, k2a, k2b }, \
+    { k36, k37, k38, k39, k3a, k3b }, \
+    { k46, k47, k48, k49, k4a, k4b }  \
+}
+// clang-format on
+
+typedef uint8_t  matrix_row_t;
+typedef uint32_t layer_state_t;
+
+// keycodes.h
+
+// clang-format off
+enum qk_keycode_defines {
+    KC_NO = 0x0000, KC_TRNS,
+    KC_A = 0x0004, KC_B, KC_C, KC_D, KC_E, KC_F, KC_G, KC_H, KC_I, KC_J, KC_K, KC_L, KC_M,
+    KC_N, KC_O, KC_P, KC_Q, KC_R, KC_S, KC_T, KC_U, KC_V, KC_W, KC_X, KC_Y, KC_Z,
+    KC_1, KC_2, KC_3, KC_4, KC_5, KC_6, KC_7, KC_8, KC_9, KC_0,
+    KC_ENT, KC_ESC, KC_BSPC, KC_TAB, KC_SPC, KC_MINS, KC_EQL, KC_LBRC, KC_RBRC, KC_BSLS,
+    KC_NUHS, KC_SCLN, KC_QUOT, KC_GRV, KC_COMM, KC_DOT, KC_SLSH, KC_CAPS,
+    KC_F1, KC_F2, KC_F3, KC_F4, KC_F5, KC_F6, KC_F7, KC_F8, KC_F9, KC_F10, KC_F11, KC_F12,
+    KC_PSCR, KC_SCRL, KC_PAUS, KC_INS, KC_HOME, KC_PGUP, KC_DEL, KC_END, KC_PGDN,
+    KC_RGHT, KC_LEFT, KC_DOWN, KC_UP,
+    KC_MUTE = 0x00A8, KC_VOLU, KC_VOLD,
+    KC_MPLY = 0x00AE,
+    KC_LCTL = 0x00E0, KC_LSFT, KC_LALT, KC_LGUI, KC_RCTL, KC_RSFT, KC_RALT, KC_RGUI,
+
+    QK_MODS         = 0x0100,
+    QK_LCTL         = 0x0100,
+    QK_LSFT         = 0x0200,
+    QK_LALT         = 0x0400,
+    QK_LGUI         = 0x0800,
+    QK_MODS_MAX     = 0x1FFF,
+    QK_MOD_TAP      = 0x2000,
+    QK_MOD_TAP_MAX  = 0x3FFF,
+    QK_ONE_SHOT_MOD = 0x52A0,
+    QK_ONE_SHOT_MOD_MAX = 0x52BF,
+    QK_TAP_DANCE    = 0x5700,
+    QK_TAP_DANCE_MAX = 0x57FF,
+
+    QK_BOOT = 0x7C00, DB_TOGG, AU_ON, AU_OFF, AG_NORM, AG_SWAP, MU_ON, MU_OFF, MI_ON, MI_OFF,
+    DT_PRNT, DT_UP, DT_DOWN, QK_LEAD,
+    SAFE_RANGE = 0x7E00,
+};
+// clang-format on
+
+#define _______ KC_TRNS
+#define XXXXXXX KC_NO
+
+#define KC_QUOTE KC_QUOT
+#define KC_MINUS KC_MINS
+#define KC_HYPR HYPR(KC_NO)
+
+#define LCTL(kc) (QK_LCTL | (kc))
+#define LSFT(kc) (QK_LSFT | (kc))
+#define LALT(kc) (QK_LALT | (kc))
+#define LGUI(kc) (QK_LGUI | (kc))
+#define HYPR(kc) (QK_LCTL | QK_LSFT | QK_LALT | QK_LGUI | (kc))
+
+#define KC_TILD LSFT(KC_GRV)
+#define KC_TILDE KC_TILD
+#define KC_EXLM LSFT(KC_1)
+#define KC_AT LSFT(KC_2)
+#define KC_HASH LSFT(KC_3)
+#define KC_DLR LSFT(KC_4)
+#define KC_PERC LSFT(KC_5)
+#define KC_CIRC LSFT(KC_6)
+#define KC_AMPR LSFT(KC_7)
+#define KC_ASTR LSFT(KC_8)
+#define KC_LPRN LSFT(KC_9)
+#define KC_RPRN LSFT(KC_0)
+#define KC_UNDS LSFT(KC_MINS)
+#define KC_PLUS LSFT(KC_EQL)
+#define KC_LCBR LSFT(KC_LBRC)
+#define KC_RCBR LSFT(KC_RBRC)
+#define KC_PIPE LSFT(KC_BSLS)
+#define KC_DOUBLE_QUOTE LSFT(KC_QUOT)
+#define KC_LABK LSFT(KC_COMM)
+#define KC_RABK LSFT(KC_DOT)
+
+#define MOD_LCTL 0x01
+#define MOD_LSFT 0x02
+#define MOD_LALT 0x04
+#define MOD_LGUI 0x08
+#define MOD_RCTL 0x11
+#define MOD_RSFT 0x12
+#define MOD_RALT 0x14
+#define MOD_RGUI 0x18
+
+#define MOD_BIT(kc) (1 << ((kc)&0x07))
+#define MOD_MASK_SHIFT (MOD_BIT(KC_LSFT) | MOD_BIT(KC_RSFT))
+
+#define MT(mod, kc) (QK_MOD_TAP | (((mod)&0x1F) << 8) | ((kc)&0xFF))
+#define LCTL_T(kc) MT(MOD_LCTL, kc)
+#define LSFT_T(kc) MT(MOD_LSFT, kc)
+#define LALT_T(kc) MT(MOD_LALT, kc)
+#define LGUI_T(kc) MT(MOD_LGUI, kc)
+#define RCTL_T(kc) MT(MOD_RCTL, kc)
+#define RSFT_T(kc) MT(MOD_RSFT, kc)
+#define RGUI_T(kc) MT(MOD_RGUI, kc)
+#define OSM(mod) (QK_ONE_SHOT_MOD | ((mod)&0x1F))
+#define TD(i) (QK_TAP_DANCE | ((i)&0xFF))
+
+#define QK_MODS_GET_MODS(kc) (((kc) >> 8) & 0x1F)
+#define QK_MOD_TAP_GET_MODS(kc) (((kc) >> 8) & 0x1F)
+#define QK_MOD_TAP_GET_TAP_KEYCODE(kc) ((kc)&0xFF)
+#define QK_ONE_SHOT_MOD_GET_MODS(kc) ((kc)&0x1F)
+
+#define IS_BASIC_KEYCODE(code) ((code) >= KC_A && (code) <= 0xA4)
+#define IS_MODIFIER_KEYCODE(code) ((code) >= KC_LCTL && (code) <= KC_RGUI)
+#define IS_QK_MODS(code) ((code) >= QK_MODS && (code) <= QK_MODS_MAX)
+#define IS_QK_MOD_TAP(code) ((code) >= QK_MOD_TAP && (code) <= QK_MOD_TAP_MAX)
+#define IS_QK_ONE_SHOT_MOD(code) ((code) >= QK_ONE_SHOT_MOD && (code) <= QK_ONE_SHOT_MOD_MAX)
+#define IS_QK_TAP_DANCE(code) ((code) >= QK_TAP_DANCE && (code) <= QK_TAP_DANCE_MAX)
+
+// keyboard.h, action.h
+
+typedef struct {
+    uint8_t col;
+    uint8_t row;
+} keypos_t;
+
+typedef enum keyevent_type_t { TICK_EVENT = 0, KEY_EVENT = 1, ENCODER_CW_EVENT = 2, ENCODER_CCW_EVENT = 3, COMBO_EVENT = 4 } keyevent_type_t;
+
+typedef struct {
+    keypos_t        key;
+    uint16_t        time;
+    keyevent_type_t type;
+    bool            pressed;
+} keyevent_t;
+
+typedef struct {
+    bool    interrupted : 1;
+    bool    reserved2 : 1;
+    bool    reserved1 : 1;
+    bool    reserved0 : 1;
+    uint8_t count : 4;
+} tap_t;
+
+typedef struct {
+    keyevent_t event;
+    tap_t      tap;
+} keyrecord_t;
+
+#define KEYEQ(keya, keyb) ((keya).row == (keyb).row && (keya).col == (keyb).col)
+#define MAKE_KEYEVENT(row_num, col_num, press) ((keyevent_t){.key = ((keypos_t){.row = (row_num), .col = (col_num)}), .pressed = (press), .time = (timer_read() | 1), .type = KEY_EVENT})
+
+void action_exec(keyevent_t event);
+
+// timer.h
+
+uint16_t timer_read(void);
+uint32_t timer_read32(void);
+uint16_t timer_elapsed(uint16_t last);
+uint32_t timer_elapsed32(uint32_t last);
+void     wait_ms(uint32_t ms);
+
+#define TIMER_DIFF_16(a, b) (uint16_t)((a) - (b))
+#define TIMER_DIFF_32(a, b) (uint32_t)((a) - (b))
+#define timer_expired(current, future) ((uint16_t)((current) - (future)) < UINT16_MAX / 2)
+#define timer_expired32(current, future) ((uint32_t)((current) - (future)) < UINT32_MAX / 2)
+
+// action_util.h, action.h, report.h
+
+#define KEYBOARD_REPORT_KEYS 6
+
+uint8_t get_mods(void);
+void    add_mods(uint8_t mods);
+void    del_mods(uint8_t mods);
+void    set_mods(uint8_t mods);
+void    clear_mods(void);
+uint8_t get_weak_mods(void);
+void    add_weak_mods(uint8_t mods);
+void    del_weak_mods(uint8_t mods);
+uint8_t get_oneshot_mods(void);
+void    add_key(uint8_t key);
+void    del_key(uint8_t key);
+void    send_keyboard_report(void);
+void    clear_keyboard(void);
+
+void register_code(uint8_t code);
+void unregister_code(uint8_t code);
+void tap_code(uint8_t code);
+void register_code16(uint16_t code);
+void unregister_code16(uint16_t code);
+void tap_code16(uint16_t code);
+void register_mods(uint8_t mods);
+void unregister_mods(uint8_t mods);
+
+// action_layer.h
+
+extern layer_state_t layer_state;
+extern layer_state_t default_layer_state;
+
+void          layer_state_set(layer_state_t state);
+bool          layer_state_is(uint8_t layer);
+void          default_layer_state_set(layer_state_t state);
+uint8_t       get_highest_layer(layer_state_t state);
+layer_state_t layer_state_set_user(layer_state_t state);
+layer_state_t default_layer_state_set_user(layer_state_t state);
+
+#define IS_LAYER_ON(layer) layer_state_is(layer)
+
+// keymap_common.h, keymap_introspection.h
+
+extern const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
+
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key);
+uint16_t keycode_at_keymap_location(uint8_t layer, uint8_t row, uint8_t col);
+
+// quantum.h user hooks
+
+bool pre_process_record_user(uint16_t keycode, keyrecord_t *record);
+bool process_record_user(uint16_t keycode, keyrecord_t *record);
+void post_process_record_user(uint16_t keycode, keyrecord_t *record);
+void matrix_scan_user(void);
+void keyboard_post_init_user(void);
+void suspend_power_down_user(void);
+bool encoder_update_user(uint8_t index, bool clockwise);
+bool dip_switch_update_user(uint8_t index, bool active);
+bool music_mask_user(uint16_t keycode);
+
+// process_tap_dance.h
+
+typedef struct {
+    uint16_t interrupting_keycode;
+    uint8_t  count;
+    uint8_t  weak_mods;
+    bool     pressed : 1;
+    bool     finished : 1;
+    bool     interrupted : 1;
+} tap_dance_state_t;
+
+typedef void (*tap_dance_user_fn_t)(tap_dance_state_t *state, void *user_data);
+
+typedef struct {
+    struct {
+        tap_dance_user_fn_t on_each_tap;
+        tap_dance_user_fn_t on_dance_finished;
+        tap_dance_user_fn_t on_reset;
+        tap_dance_user_fn_t on_each_release;
+    } fn;
+    void *user_data;
+} tap_dance_action_t;
+
+typedef struct {
+    uint16_t kc1;
+    uint16_t kc2;
+} tap_dance_pair_t;
+
+extern tap_dance_action_t tap_dance_actions[];
+
+void tap_dance_pair_on_each_tap(tap_dance_state_t *state, void *user_data);
+void tap_dance_pair_finished(tap_dance_state_t *state, void *user_data);
+void tap_dance_pair_reset(tap_dance_state_t *state, void *user_data);
+
+#define ACTION_TAP_DANCE_DOUBLE(kc1, kc2) \
+    { .fn = {tap_dance_pair_on_each_tap, tap_dance_pair_finished, tap_dance_pair_reset, NULL}, .user_data = (void *)&((tap_dance_pair_t){kc1, kc2}), }
+
+// process_dynamic_tapping_term.h
+
+extern uint16_t g_tapping_term;
+
+uint16_t get_tapping_term(uint16_t keycode, keyrecord_t *record);
+
+// leader.h
+
+bool leader_sequence_active(void);
+void leader_start_user(void);
+bool leader_add_user(uint16_t keycode);
+void leader_end_user(void);
+
+// send_string.h
+
+#define SS_QMK_PREFIX 1
+#define SS_TAP_CODE 1
+#define SS_DOWN_CODE 2
+#define SS_UP_CODE 3
+#define SS_DELAY_CODE 4
+
+#define X_BSPC 2a
+#define X_END 4d
+#define X_LCTL e0
+#define X_LSFT e1
+#define X_LALT e2
+#define X_LGUI e3
+
+#define STRINGIZE(z) #z
+#define ADD_SLASH_X(y) STRINGIZE(\x##y)
+#define SS_TAP(keycode) "\1\1" ADD_SLASH_X(keycode)
+#define SS_DOWN(keycode) "\1\2" ADD_SLASH_X(keycode)
+#define SS_UP(keycode) "\1\3" ADD_SLASH_X(keycode)
+#define SS_DELAY(msecs) "\1\4" STRINGIZE(msecs) "|"
+#define SS_LCTL(string) SS_DOWN(X_LCTL) string SS_UP(X_LCTL)
+#define SS_LSFT(string) SS_DOWN(X_LSFT) string SS_UP(X_LSFT)
+#define SS_LALT(string) SS_DOWN(X_LALT) string SS_UP(X_LALT)
+#define SS_LGUI(string) SS_DOWN(X_LGUI) string SS_UP(X_LGUI)
+
+extern const uint8_t ascii_to_keycode_lut[128];
+extern const uint8_t ascii_to_shift_lut[16];
+extern const uint8_t ascii_to_altgr_lut[16];
+
+void send_char(char ascii_code);
+void send_string(const char *string);
+void send_string_P(const char *string);
+
+#define SEND_STRING(string) send_string_P(PSTR(string))
+
+const char *get_u16_str(uint16_t curr_num, char curr_pad);
+
+// print.h, debug.h
+
+extern bool debug_enable;
+
+int host_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+#define uprintf(...) host_printf(__VA_ARGS__)
+
+// eeprom.h, eeconfig.h
+
+#define EECONFIG_BASE_SIZE 64
+#define EECONFIG_USER_DATABLOCK ((uint8_t *)EECONFIG_BASE_SIZE)
+#define EECONFIG_SIZE (EECONFIG_BASE_SIZE + EECONFIG_USER_DATA_SIZE)
+#define TOTAL_EEPROM_BYTE_COUNT 1024
+
+void eeprom_read_block(void *buf, const void *addr, size_t len);
+void eeprom_update_block(const void *buf, void *addr, size_t len);
+
+// usb_device_state.h
+
+enum usb_device_state {
+    USB_DEVICE_STATE_NO_INIT    = 0,
+    USB_DEVICE_STATE_INIT       = 1,
+    USB_DEVICE_STATE_CONFIGURED = 2,
+    USB_DEVICE_STATE_SUSPEND    = 3,
+};
+
+void notify_usb_device_state_change_user(enum usb_device_state usb_device_state);
+
+// audio.h, song_list.h
+
+#define SONG(...) __VA_ARGS__
+#define NO_SOUND {{0.0f, 1}}
+#define PREONIC_SOUND {{440.0f, 16}, {0.0f, 8}, {880.0f, 16}}
+#define QWERTY_SOUND NO_SOUND
+#define COLEMAK_SOUND NO_SOUND
+#define DVORAK_SOUND NO_SOUND
+
+void play_note(float freq, int vol);
+void stop_note(float freq);
+void stop_all_notes(void);
+bool is_playing_notes(void);
+void audio_play_melody(float (*np)[][2], uint16_t n_count, bool n_repeat);
+
+#define PLAY_SONG(note_array) audio_play_melody(&note_array, sizeof(note_array) / sizeof(note_array[0]), false)
+
+// muse.h
+
+extern bool     muse_mode;
+extern uint8_t  muse_offset;
+extern uint16_t muse_tempo;
@@ -0,0 +1,999 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * A host stand-in for the parts of the QMK core this keymap runs on: the
+ * event pipeline (pre_process_record, tapping, process_record and
+ * process_action), the tap dance and leader engines, layers, the keyboard
+ * report, send_string, EEPROM and audio. Each follows QMK's behaviour for
+ * the options config.h and rules.mk turn on and nothing more; mod-taps
+ * resolve on timing alone, as QMK does without PERMISSIVE_HOLD or
+ * HOLD_ON_OTHER_KEY_PRESS, and one-shot mods act as plain mods.
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "debounce.h"
+#include "host.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static void process_record(keyrecord_t *record);
+
+// Clock
+
+static uint32_t host_clock;
+
+uint16_t timer_read(void) {
+    return host_clock;
+}
+
+uint32_t timer_read32(void) {
+    return host_clock;
+}
+
+uint16_t timer_elapsed(uint16_t last) {
+    return TIMER_DIFF_16(timer_read(), last);
+}
+
+uint32_t timer_elapsed32(uint32_t last) {
+    return TIMER_DIFF_32(timer_read32(), last);
+}
+
+void wait_ms(uint32_t ms) {
+    host_clock += ms;
+}
+
+uint32_t host_now(void) {
+    return host_clock;
+}
+
+// Output log
+
+static char   host_report_log[1 << 16];
+static size_t host_report_length;
+static char   host_text_log[1 << 16];
+static size_t host_text_length;
+static char   host_console_log[1 << 16];
+static size_t host_console_length;
+
+static void host_append(char *log, size_t size, size_t *length, const char *format, ...) __attribute__((format(printf, 4, 5)));
+
+static void host_append(char *log, size_t size, size_t *length, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(log + *length, size - *length, format, args);
+    va_end(args);
+    if (n > 0) {
+        *length += (size_t)n < size - *length ? (size_t)n : size - *length - 1;
+    }
+}
+
+const char *host_reports(void) {
+    return host_report_log;
+}
+
+const char *host_text(void) {
+    return host_text_log;
+}
+
+void host_output_clear(void) {
+    host_report_length = host_text_length = 0;
+    host_report_log[0] = host_text_log[0] = '\0';
+}
+
+const char *host_console(void) {
+    return host_console_log;
+}
+
+int host_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(host_console_log + host_console_length, sizeof(host_console_log) - host_console_length, format, args);
+    va_end(args);
+    if (n > 0) {
+        host_console_length += (size_t)n < sizeof(host_console_log) - host_console_length ? (size_t)n : sizeof(host_console_log) - host_console_length - 1;
+    }
+    return n;
+}
+
+// Keyboard report
+
+// clang-format off
+static const char *const key_names[] = {
+    [KC_ENT] = "ent", [KC_ESC] = "esc", [KC_BSPC] = "bspc", [KC_TAB] = "tab", [KC_SPC] = "spc",
+    [KC_MINS] = "mins", [KC_EQL] = "eql", [KC_LBRC] = "lbrc", [KC_RBRC] = "rbrc", [KC_BSLS] = "bsls",
+    [KC_NUHS] = "nuhs", [KC_SCLN] = "scln", [KC_QUOT] = "quot", [KC_GRV] = "grv", [KC_COMM] = "comm",
+    [KC_DOT] = "dot", [KC_SLSH] = "slsh", [KC_CAPS] = "caps",
+    [KC_F1] = "f1", [KC_F2] = "f2", [KC_F3] = "f3", [KC_F4] = "f4", [KC_F5] = "f5", [KC_F6] = "f6",
+    [KC_F7] = "f7", [KC_F8] = "f8", [KC_F9] = "f9", [KC_F10] = "f10", [KC_F11] = "f11", [KC_F12] = "f12",
+    [KC_PSCR] = "pscr", [KC_SCRL] = "scrl", [KC_PAUS] = "paus", [KC_INS] = "ins", [KC_HOME] = "home",
+    [KC_PGUP] = "pgup", [KC_DEL] = "del", [KC_END] = "end", [KC_PGDN] = "pgdn", [KC_RGHT] = "rght",
+    [KC_LEFT] = "left", [KC_DOWN] = "down", [KC_UP] = "up",
+    [KC_MUTE] = "mute", [KC_VOLU] = "volu", [KC_VOLD] = "vold", [KC_MPLY] = "mply",
+};
+
+static const char *const mod_names[8] = {"lctl", "lsft", "lalt", "lgui", "rctl", "rsft", "ralt", "rgui"};
+
+// US layout, unshifted and shifted, for KC_A..KC_SLSH.
+static const char key_chars[2][KC_SLSH - KC_A + 2] = {
+    "abcdefghijklmnopqrstuvwxyz1234567890\n\x1b\b\t -=[]\\#;'`,./",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ!@#$%^&*()\n\x1b\b\t _+{}|~:\"~<>?",
+};
+// clang-format on
+
+static const char *key_name(uint8_t key, char *buffer) {
+    if (key >= KC_A && key <= KC_0) {
+        buffer[0] = key_chars[0][key - KC_A];
+        buffer[1] = '\0';
+    } else if (key < ARRAY_SIZE(key_names) && key_names[key]) {
+        return key_names[key];
+    } else {
+        sprintf(buffer, "0x%02X", key);
+    }
+    return buffer;
+}
+
+static uint8_t real_mods;
+static uint8_t weak_mods;
+static bool    keys_down[256];
+
+static struct {
+    uint8_t mods;
+    bool    keys[256];
+} sent_report;
+static uint32_t key_sends[256];
+
+static void host_text_key(uint8_t key, uint8_t mods) {
+    char name[8];
+    bool shifted = mods & MOD_MASK_SHIFT;
+    if (!(mods & ~MOD_MASK_SHIFT) && key >= KC_A && key <= KC_SLSH && key != KC_ESC && key != KC_TAB) {
+        char c = key_chars[shifted][key - KC_A];
+        if (c == '\b') {
+            if (host_text_length) {
+                host_text_log[--host_text_length] = '\0';
+            }
+        } else {
+            host_append(host_text_log, sizeof(host_text_log), &host_text_length, "%c", c);
+        }
+        return;
+    }
+    host_append(host_text_log, sizeof(host_text_log), &host_text_length, "<");
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if (mods & (1 << bit)) {
+            host_append(host_text_log, sizeof(host_text_log), &host_text_length, "%s+", mod_names[bit]);
+        }
+    }
+    host_append(host_text_log, sizeof(host_text_log), &host_text_length, "%s>", key_name(key, name));
+}
+
+static bool            host_costing = false;
+static host_cost_t     host_costs;
+static struct timespec host_cost_start;
+
+void send_keyboard_report(void) {
+    struct timespec start;
+    if (host_costing) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    }
+    uint8_t mods = real_mods | weak_mods;
+    char    name[8];
+    for (int key = 0; key < 256; key++) {
+        if (sent_report.keys[key] && !keys_down[key]) {
+            host_append(host_report_log, sizeof(host_report_log), &host_report_length, "%s-%s", host_report_length ? " " : "", key_name(key, name));
+        }
+    }
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if ((sent_report.mods & ~mods) & (1 << bit)) {
+            host_append(host_report_log, sizeof(host_report_log), &host_report_length, "%s-%s", host_report_length ? " " : "", mod_names[bit]);
+        }
+    }
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if ((mods & ~sent_report.mods) & (1 << bit)) {
+            host_append(host_report_log, sizeof(host_report_log), &host_report_length, "%s+%s", host_report_length ? " " : "", mod_names[bit]);
+        }
+    }
+    for (int key = 0; key < 256; key++) {
+        if (!sent_report.keys[key] && keys_down[key]) {
+            host_append(host_report_log, sizeof(host_report_log), &host_report_length, "%s+%s", host_report_length ? " " : "", key_name(key, name));
+            host_text_key(key, mods);
+            key_sends[key]++;
+        }
+    }
+    sent_report.mods = mods;
+    memcpy(sent_report.keys, keys_down, sizeof(keys_down));
+
+    if (host_costing) {
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        host_costs.reports++;
+        host_costs.report_ns += (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000u + end.tv_nsec - start.tv_nsec;
+    }
+}
+
+uint32_t host_key_sends(uint8_t key) {
+    return key_sends[key];
+}
+
+uint8_t get_mods(void) {
+    return real_mods;
+}
+
+void add_mods(uint8_t mods) {
+    real_mods |= mods;
+}
+
+void del_mods(uint8_t mods) {
+    real_mods &= ~mods;
+}
+
+void set_mods(uint8_t mods) {
+    real_mods = mods;
+}
+
+void clear_mods(void) {
+    real_mods = 0;
+}
+
+uint8_t get_weak_mods(void) {
+    return weak_mods;
+}
+
+void add_weak_mods(uint8_t mods) {
+    weak_mods |= mods;
+}
+
+void del_weak_mods(uint8_t mods) {
+    weak_mods &= ~mods;
+}
+
+uint8_t get_oneshot_mods(void) {
+    return 0;
+}
+
+void add_key(uint8_t key) {
+    keys_down[key] = true;
+}
+
+void del_key(uint8_t key) {
+    keys_down[key] = false;
+}
+
+void clear_keyboard(void) {
+    real_mods = weak_mods = 0;
+    memset(keys_down, 0, sizeof(keys_down));
+    send_keyboard_report();
+}
+
+// action.c
+
+/* A 5-bit mod mask from a keycode as report bits. */
+static uint8_t mod_config_bits(uint8_t mods) {
+    return mods & 0x10 ? (mods & 0x0F) << 4 : mods & 0x0F;
+}
+
+void register_code(uint8_t code) {
+    if (code == KC_NO || code == KC_TRNS) {
+        return;
+    }
+    if (IS_MODIFIER_KEYCODE(code)) {
+        add_mods(MOD_BIT(code));
+    } else {
+        add_key(code);
+    }
+    send_keyboard_report();
+}
+
+void unregister_code(uint8_t code) {
+    if (code == KC_NO || code == KC_TRNS) {
+        return;
+    }
+    if (IS_MODIFIER_KEYCODE(code)) {
+        del_mods(MOD_BIT(code));
+    } else {
+        del_key(code);
+    }
+    send_keyboard_report();
+}
+
+void tap_code(uint8_t code) {
+    register_code(code);
+    unregister_code(code);
+}
+
+void register_mods(uint8_t mods) {
+    if (mods) {
+        add_mods(mods);
+        send_keyboard_report();
+    }
+}
+
+void unregister_mods(uint8_t mods) {
+    if (mods) {
+        del_mods(mods);
+        send_keyboard_report();
+    }
+}
+
+static void register_weak_mods(uint8_t mods) {
+    if (mods) {
+        add_weak_mods(mods);
+        send_keyboard_report();
+    }
+}
+
+static void unregister_weak_mods(uint8_t mods) {
+    if (mods) {
+        del_weak_mods(mods);
+        send_keyboard_report();
+    }
+}
+
+void register_code16(uint16_t code) {
+    uint8_t mods = mod_config_bits(QK_MODS_GET_MODS(code));
+    if (IS_MODIFIER_KEYCODE(code & 0xFF) || (code & 0xFF) == KC_NO) {
+        register_mods(mods);
+    } else {
+        register_weak_mods(mods);
+    }
+    register_code(code);
+}
+
+void unregister_code16(uint16_t code) {
+    uint8_t mods = mod_config_bits(QK_MODS_GET_MODS(code));
+    unregister_code(code);
+    if (IS_MODIFIER_KEYCODE(code & 0xFF) || (code & 0xFF) == KC_NO) {
+        unregister_mods(mods);
+    } else {
+        unregister_weak_mods(mods);
+    }
+}
+
+void tap_code16(uint16_t code) {
+    register_code16(code);
+    unregister_code16(code);
+}
+
+// Layers
+
+layer_state_t layer_state         = 0;
+layer_state_t default_layer_state = 0;
+
+void layer_state_set(layer_state_t state) {
+    layer_state = layer_state_set_user(state);
+}
+
+void default_layer_state_set(layer_state_t state) {
+    default_layer_state = default_layer_state_set_user(state);
+}
+
+bool layer_state_is(uint8_t layer) {
+    if (!layer_state) {
+        return layer == 0;
+    }
+    return layer_state & ((layer_state_t)1 << layer);
+}
+
+uint8_t get_highest_layer(layer_state_t state) {
+    for (int8_t layer = 31; layer > 0; layer--) {
+        if (state & ((layer_state_t)1 << layer)) {
+            return layer;
+        }
+    }
+    return 0;
+}
+
+uint16_t keycode_at_keymap_location(uint8_t layer, uint8_t row, uint8_t col) {
+    return keymaps[layer][row][col];
+}
+
+__attribute__((weak)) uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) {
+    return keycode_at_keymap_location(layer, key.row, key.col);
+}
+
+__attribute__((weak)) layer_state_t default_layer_state_set_user(layer_state_t state) {
+    return state;
+}
+
+static uint8_t source_layers[MATRIX_ROWS][MATRIX_COLS];
+
+static uint8_t layer_switch_get_layer(keypos_t key) {
+    layer_state_t layers = layer_state | default_layer_state;
+    for (int8_t layer = 31; layer >= 0; layer--) {
+        if ((layers & ((layer_state_t)1 << layer)) && keymap_key_to_keycode(layer, key) != KC_TRNS) {
+            return layer;
+        }
+    }
+    return 0;
+}
+
+/* get_record_keycode: presses resolve through the layers, releases use the layer their press did. */
+static uint16_t record_keycode(keyrecord_t *record, bool update_layer_cache) {
+    keypos_t key = record->event.key;
+    if (record->event.pressed && update_layer_cache) {
+        source_layers[key.row][key.col] = layer_switch_get_layer(key);
+    }
+    return keymap_key_to_keycode(source_layers[key.row][key.col], key);
+}
+
+// Tapping (action_tapping.c)
+
+uint16_t g_tapping_term = TAPPING_TERM;
+
+#define TAPPING_WAITING_MAX 16
+
+static keyrecord_t tapping_key;
+static bool        tapping_active = false;
+static keyrecord_t tapping_waiting[TAPPING_WAITING_MAX];
+static uint8_t     tapping_waiting_count = 0;
+
+static void tapping_process(keyrecord_t record);
+
+static void tapping_flush(void) {
+    keyrecord_t waiting[TAPPING_WAITING_MAX];
+    uint8_t     count = tapping_waiting_count;
+    memcpy(waiting, tapping_waiting, sizeof(waiting));
+    tapping_waiting_count = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        tapping_process(waiting[i]);
+    }
+}
+
+static void tapping_process(keyrecord_t record) {
+    if (tapping_active) {
+        if (record.event.pressed || !KEYEQ(record.event.key, tapping_key.event.key)) {
+            if (record.event.pressed) {
+                tapping_key.tap.interrupted = true;
+            }
+            if (tapping_waiting_count < TAPPING_WAITING_MAX) {
+                tapping_waiting[tapping_waiting_count++] = record;
+            }
+            return;
+        }
+        // Released within the term: a tap, followed by whatever waited on it.
+        tapping_active        = false;
+        tapping_key.tap.count = 1;
+        process_record(&tapping_key);
+        record.tap = tapping_key.tap;
+        process_record(&record);
+        tapping_flush();
+        return;
+    }
+    uint16_t keycode = record_keycode(&record, false);
+    if (record.event.pressed && IS_QK_MOD_TAP(keycode)) {
+        tapping_key     = record;
+        tapping_key.tap = (tap_t){0};
+        tapping_active  = true;
+        return;
+    }
+    process_record(&record);
+}
+
+static void tapping_task(void) {
+    if (!tapping_active) {
+        return;
+    }
+    uint16_t keycode = record_keycode(&tapping_key, false);
+    if (TIMER_DIFF_16(timer_read(), tapping_key.event.time) < get_tapping_term(keycode, &tapping_key)) {
+        return;
+    }
+    tapping_active        = false;
+    tapping_key.tap.count = 0;
+    process_record(&tapping_key);
+    tapping_flush();
+}
+
+// Tap dance (process_tap_dance.c)
+
+#define TAP_DANCE_MAX 32
+
+static tap_dance_state_t tap_dance_states[TAP_DANCE_MAX];
+static int16_t           tap_dance_active = -1;
+static uint16_t          tap_dance_last_tap;
+
+static void tap_dance_call(tap_dance_user_fn_t fn, uint8_t index) {
+    if (fn) {
+        fn(&tap_dance_states[index], tap_dance_actions[index].user_data);
+    }
+}
+
+static void tap_dance_finish(uint8_t index) {
+    if (!tap_dance_states[index].finished) {
+        tap_dance_states[index].finished = true;
+        tap_dance_call(tap_dance_actions[index].fn.on_dance_finished, index);
+    }
+}
+
+static void tap_dance_reset(uint8_t index) {
+    tap_dance_call(tap_dance_actions[index].fn.on_reset, index);
+    memset(&tap_dance_states[index], 0, sizeof(tap_dance_states[index]));
+    if (tap_dance_active == index) {
+        tap_dance_active = -1;
+    }
+}
+
+static void preprocess_tap_dance(uint16_t keycode, keyrecord_t *record) {
+    if (!record->event.pressed || tap_dance_active < 0 || keycode == TD(tap_dance_active)) {
+        return;
+    }
+    uint8_t index                                = tap_dance_active;
+    tap_dance_states[index].interrupted          = true;
+    tap_dance_states[index].interrupting_keycode = keycode;
+    tap_dance_finish(index);
+    tap_dance_active = -1;
+    if (!tap_dance_states[index].pressed) {
+        tap_dance_reset(index);
+    }
+}
+
+static bool process_tap_dance(uint16_t keycode, keyrecord_t *record) {
+    if (!IS_QK_TAP_DANCE(keycode)) {
+        return true;
+    }
+    uint8_t            index = keycode & 0xFF;
+    tap_dance_state_t *state = &tap_dance_states[index];
+    state->pressed           = record->event.pressed;
+    if (record->event.pressed) {
+        tap_dance_last_tap = timer_read();
+        state->count++;
+        tap_dance_call(tap_dance_actions[index].fn.on_each_tap, index);
+        tap_dance_active = state->finished ? -1 : index;
+    } else {
+        tap_dance_call(tap_dance_actions[index].fn.on_each_release, index);
+        if (state->finished) {
+            tap_dance_reset(index);
+        }
+    }
+    return false;
+}
+
+static void tap_dance_task(void) {
+    if (tap_dance_active < 0) {
+        return;
+    }
+    uint8_t     index  = tap_dance_active;
+    keyrecord_t record = {0};
+    if (timer_elapsed(tap_dance_last_tap) <= get_tapping_term(TD(index), &record)) {
+        return;
+    }
+    tap_dance_finish(index);
+    tap_dance_active = -1;
+    if (!tap_dance_states[index].pressed) {
+        tap_dance_reset(index);
+    }
+}
+
+void tap_dance_pair_on_each_tap(tap_dance_state_t *state, void *user_data) {
+    tap_dance_pair_t *pair = user_data;
+    if (state->count == 2) {
+        register_code16(pair->kc2);
+        state->finished = true;
+    }
+}
+
+void tap_dance_pair_finished(tap_dance_state_t *state, void *user_data) {
+    tap_dance_pair_t *pair = user_data;
+    register_code16(pair->kc1);
+}
+
+void tap_dance_pair_reset(tap_dance_state_t *state, void *user_data) {
+    tap_dance_pair_t *pair = user_data;
+    if (state->count == 1) {
+        unregister_code16(pair->kc1);
+    } else if (state->count == 2) {
+        unregister_code16(pair->kc2);
+    }
+}
+
+// Leader (process_leader.c, LEADER_PER_KEY_TIMING)
+
+static bool     leading = false;
+static uint16_t leader_time;
+
+bool leader_sequence_active(void) {
+    return leading;
+}
+
+static void leader_end(void) {
+    leading = false;
+    leader_end_user();
+}
+
+static bool process_leader(uint16_t keycode, keyrecord_t *record) {
+    if (!record->event.pressed) {
+        return true;
+    }
+    if (leading) {
+        if (IS_QK_MOD_TAP(keycode)) {
+            keycode = QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
+        }
+        leader_time = timer_read();
+        if (leader_add_user(keycode)) {
+            leader_end();
+        }
+        return false;
+    }
+    if (keycode == QK_LEAD) {
+        leading     = true;
+        leader_time = timer_read();
+        leader_start_user();
+        return false;
+    }
+    return true;
+}
+
+static void leader_task(void) {
+    if (leading && timer_elapsed(leader_time) > LEADER_TIMEOUT) {
+        leader_end();
+    }
+}
+
+// Quantum keycodes
+
+bool debug_enable = false;
+
+static bool process_quantum_keycodes(uint16_t keycode, keyrecord_t *record) {
+    switch (keycode) {
+        case DB_TOGG:
+            if (record->event.pressed) {
+                debug_enable = !debug_enable;
+            }
+            return false;
+        case DT_UP:
+            if (record->event.pressed) {
+                g_tapping_term += 5;
+            }
+            return false;
+        case DT_DOWN:
+            if (record->event.pressed) {
+                g_tapping_term -= 5;
+            }
+            return false;
+        case QK_BOOT:
+        case AU_ON ... DT_PRNT:
+        case QK_LEAD:
+            return false;
+        default:
+            return true;
+    }
+}
+
+// Event pipeline
+
+static void process_action(uint16_t keycode, keyrecord_t *record) {
+    bool pressed = record->event.pressed;
+    if (keycode <= 0xFF) {
+        pressed ? register_code(keycode) : unregister_code(keycode);
+    } else if (IS_QK_MODS(keycode)) {
+        pressed ? register_code16(keycode) : unregister_code16(keycode);
+    } else if (IS_QK_MOD_TAP(keycode)) {
+        if (record->tap.count) {
+            pressed ? register_code(QK_MOD_TAP_GET_TAP_KEYCODE(keycode)) : unregister_code(QK_MOD_TAP_GET_TAP_KEYCODE(keycode));
+        } else {
+            uint8_t mods = mod_config_bits(QK_MOD_TAP_GET_MODS(keycode));
+            pressed ? register_mods(mods) : unregister_mods(mods);
+        }
+    } else if (IS_QK_ONE_SHOT_MOD(keycode)) {
+        uint8_t mods = mod_config_bits(QK_ONE_SHOT_MOD_GET_MODS(keycode));
+        pressed ? register_mods(mods) : unregister_mods(mods);
+    }
+}
+
+static void process_record(keyrecord_t *record) {
+    uint16_t keycode = record_keycode(record, true);
+    preprocess_tap_dance(keycode, record);
+    if (!(process_record_user(keycode, record) && process_leader(keycode, record) && process_tap_dance(keycode, record) && process_quantum_keycodes(keycode, record))) {
+        return;
+    }
+    process_action(keycode, record);
+    post_process_record_user(keycode, record);
+}
+
+static void host_cost_begin(void) {
+    if (host_costing) {
+        clock_gettime(CLOCK_MONOTONIC, &host_cost_start);
+    }
+}
+
+static uint64_t host_cost_end(void) {
+    if (!host_costing) {
+        return 0;
+    }
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (uint64_t)(end.tv_sec - host_cost_start.tv_sec) * 1000000000u + end.tv_nsec - host_cost_start.tv_nsec;
+}
+
+void host_cost_enable(bool enable) {
+    host_costing = enable;
+    memset(&host_costs, 0, sizeof(host_costs));
+}
+
+host_cost_t host_cost(void) {
+    return host_costs;
+}
+
+void action_exec(keyevent_t event) {
+    keyrecord_t record = {.event = event};
+    if (!pre_process_record_user(record_keycode(&record, true), &record)) {
+        return;
+    }
+    tapping_process(record);
+}
+
+// Matrix
+
+static matrix_row_t host_raw[MATRIX_ROWS];
+static matrix_row_t host_raw_scanned[MATRIX_ROWS];
+static matrix_row_t host_cooked[MATRIX_ROWS];
+
+void host_switch(keypos_t key, bool closed) {
+    if (closed) {
+        host_raw[key.row] |= (matrix_row_t)1 << key.col;
+    } else {
+        host_raw[key.row] &= ~((matrix_row_t)1 << key.col);
+    }
+}
+
+/* One pass of keyboard_task: scan, debounce, events, then the timed engines. */
+static void host_scan(void) {
+    struct timespec start;
+    uint32_t        reports = host_costs.reports, notes = host_costs.notes;
+    if (host_costing) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    }
+
+    matrix_row_t raw[MATRIX_ROWS], previous[MATRIX_ROWS];
+    bool         changed = memcmp(host_raw, host_raw_scanned, sizeof(host_raw)) != 0;
+    memcpy(host_raw_scanned, host_raw, sizeof(host_raw));
+    memcpy(raw, host_raw, sizeof(raw));
+    memcpy(previous, host_cooked, sizeof(previous));
+    debounce(raw, host_cooked, MATRIX_ROWS, changed);
+    matrix_scan_user();
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        matrix_row_t edges = host_cooked[row] ^ previous[row];
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (edges & ((matrix_row_t)1 << col)) {
+                host_cost_begin();
+                action_exec(MAKE_KEYEVENT(row, col, host_cooked[row] & ((matrix_row_t)1 << col)));
+                uint64_t ns = host_cost_end();
+                host_costs.events++;
+                host_costs.event_ns += ns;
+                if (ns > host_costs.worst_event_ns) {
+                    host_costs.worst_event_ns = ns;
+                }
+            }
+        }
+    }
+    tapping_task();
+    tap_dance_task();
+    leader_task();
+
+    if (host_costing) {
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        uint64_t ns = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000u + end.tv_nsec - start.tv_nsec;
+        host_costs.scans++;
+        host_costs.scan_ns += ns;
+        if (host_costs.reports != reports) {
+            host_costs.report_scans++;
+            host_costs.report_scan_ns += ns;
+        }
+        if (host_costs.notes != notes) {
+            host_costs.note_scans++;
+            host_costs.note_scan_ns += ns;
+        }
+    }
+}
+
+void host_idle(uint32_t ms) {
+    while (ms--) {
+        host_clock++;
+        host_scan();
+    }
+}
+
+// send_string.c
+
+// clang-format off
+const uint8_t ascii_to_keycode_lut[128] = {
+    // NUL   SOH      STX      ETX      EOT      ENQ      ACK      BEL
+    XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX,
+    // BS    TAB      LF       VT       FF       CR       SO       SI
+    KC_BSPC, KC_TAB,  KC_ENT,  XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX,
+    // DLE   DC1      DC2      DC3      DC4      NAK      SYN      ETB
+    XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX,
+    // CAN   EM       SUB      ESC      FS       GS       RS       US
+    XXXXXXX, XXXXXXX, XXXXXXX, KC_ESC,  XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX,
+    //       !        "        #        $        %        &        '
+    KC_SPC,  KC_1,    KC_QUOT, KC_3,    KC_4,    KC_5,    KC_7,    KC_QUOT,
+    // (     )        *        +        ,        -        .        /
+    KC_9,    KC_0,    KC_8,    KC_EQL,  KC_COMM, KC_MINS, KC_DOT,  KC_SLSH,
+    // 0     1        2        3        4        5        6        7
+    KC_0,    KC_1,    KC_2,    KC_3,    KC_4,    KC_5,    KC_6,    KC_7,
+    // 8     9        :        ;        <        =        >        ?
+    KC_8,    KC_9,    KC_SCLN, KC_SCLN, KC_COMM, KC_EQL,  KC_DOT,  KC_SLSH,
+    // @     A        B        C        D        E        F        G
+    KC_2,    KC_A,    KC_B,    KC_C,    KC_D,    KC_E,    KC_F,    KC_G,
+    // H     I        J        K        L        M        N        O
+    KC_H,    KC_I,    KC_J,    KC_K,    KC_L,    KC_M,    KC_N,    KC_O,
+    // P     Q        R        S        T        U        V        W
+    KC_P,    KC_Q,    KC_R,    KC_S,    KC_T,    KC_U,    KC_V,    KC_W,
+    // X     Y        Z        [        \        ]        ^        _
+    KC_X,    KC_Y,    KC_Z,    KC_LBRC, KC_BSLS, KC_RBRC, KC_6,    KC_MINS,
+    // `     a        b        c        d        e        f        g
+    KC_GRV,  KC_A,    KC_B,    KC_C,    KC_D,    KC_E,    KC_F,    KC_G,
+    // h     i        j        k        l        m        n        o
+    KC_H,    KC_I,    KC_J,    KC_K,    KC_L,    KC_M,    KC_N,    KC_O,
+    // p     q        r        s        t        u        v        w
+    KC_P,    KC_Q,    KC_R,    KC_S,    KC_T,    KC_U,    KC_V,    KC_W,
+    // x     y        z        {        |        }        ~        DEL
+    KC_X,    KC_Y,    KC_Z,    KC_LBRC, KC_BSLS, KC_RBRC, KC_GRV,  KC_DEL,
+};
+
+// Bit (0x80 >> c % 8) of byte c / 8 is set for characters typed with Shift.
+const uint8_t ascii_to_shift_lut[16] = {
+    0x00, 0x00, 0x00, 0x00, 0x7E, 0xF0, 0x00, 0x2B,
+    0xFF, 0xFF, 0xFF, 0xE3, 0x00, 0x00, 0x00, 0x1E,
+};
+// clang-format on
+
+const uint8_t ascii_to_altgr_lut[16] = {0};
+
+void send_char(char ascii_code) {
+    uint8_t c       = ascii_code & 0x7F;
+    uint8_t keycode = ascii_to_keycode_lut[c];
+    bool    shifted = ascii_to_shift_lut[c / 8] & (0x80 >> (c % 8));
+    if (shifted) {
+        register_weak_mods(MOD_BIT(KC_LSFT));
+    }
+    tap_code(keycode);
+    if (shifted) {
+        unregister_weak_mods(MOD_BIT(KC_LSFT));
+    }
+}
+
+void send_string(const char *string) {
+    for (char c; (c = *string++);) {
+        if (c != SS_QMK_PREFIX) {
+            send_char(c);
+            continue;
+        }
+        char code = *string++;
+        if (code == SS_DELAY_CODE) {
+            uint32_t ms = 0;
+            while ((c = *string) >= '0' && c <= '9') {
+                ms = ms * 10 + c - '0';
+                string++;
+            }
+            if (c == '|') {
+                string++;
+            }
+            wait_ms(ms);
+            continue;
+        }
+        if (!code || !*string) {
+            break;
+        }
+        uint8_t keycode = *string++;
+        if (code == SS_TAP_CODE) {
+            tap_code(keycode);
+        } else if (code == SS_DOWN_CODE) {
+            register_code(keycode);
+        } else if (code == SS_UP_CODE) {
+            unregister_code(keycode);
+        }
+    }
+}
+
+void send_string_P(const char *string) {
+    send_string(string);
+}
+
+const char *get_u16_str(uint16_t curr_num, char curr_pad) {
+    static char buffer[6];
+    char       *p = &buffer[5];
+    *p            = '\0';
+    do {
+        *--p = '0' + curr_num % 10;
+        curr_num /= 10;
+    } while (curr_num && p > buffer);
+    while (p > buffer) {
+        *--p = curr_pad;
+    }
+    return buffer;
+}
+
+// EEPROM
+
+static uint8_t  host_eeprom[TOTAL_EEPROM_BYTE_COUNT];
+static uint32_t host_eeprom_changes;
+
+static size_t eeprom_offset(const void *addr, size_t len) {
+    size_t offset = (uintptr_t)addr;
+    if (offset + len > sizeof(host_eeprom)) {
+        fprintf(stderr, "eeprom: access at %zu+%zu out of range\n", offset, len);
+        abort();
+    }
+    return offset;
+}
+
+void eeprom_read_block(void *buf, const void *addr, size_t len) {
+    memcpy(buf, &host_eeprom[eeprom_offset(addr, len)], len);
+}
+
+void eeprom_update_block(const void *buf, void *addr, size_t len) {
+    uint8_t       *dest = &host_eeprom[eeprom_offset(addr, len)];
+    const uint8_t *src  = buf;
+    for (size_t i = 0; i < len; i++) {
+        if (dest[i] != src[i]) {
+            dest[i] = src[i];
+            host_eeprom_changes++;
+        }
+    }
+}
+
+uint32_t host_eeprom_writes(void) {
+    return host_eeprom_changes;
+}
+
+// Audio
+
+#define HOST_NOTES_MAX 8
+
+static float    host_playing[HOST_NOTES_MAX];
+static uint32_t host_song_end;
+
+void play_note(float freq, int vol) {
+    host_costs.notes += host_costing;
+    for (uint8_t i = 0; i < HOST_NOTES_MAX; i++) {
+        if (host_playing[i] == 0.0f) {
+            host_playing[i] = freq;
+            return;
+        }
+    }
+}
+
+void stop_note(float freq) {
+    host_costs.notes += host_costing;
+    for (uint8_t i = 0; i < HOST_NOTES_MAX; i++) {
+        if (host_playing[i] == freq) {
+            host_playing[i] = 0.0f;
+            return;
+        }
+    }
+}
+
+void stop_all_notes(void) {
+    memset(host_playing, 0, sizeof(host_playing));
+    host_song_end = host_clock;
+}
+
+bool is_playing_notes(void) {
+    return (int32_t)(host_song_end - host_clock) > 0;
+}
+
+void audio_play_melody(float (*np)[][2], uint16_t n_count, bool n_repeat) {
+    host_song_end = host_clock + 500;
+}
+
+int host_notes(void) {
+    int notes = 0;
+    for (uint8_t i = 0; i < HOST_NOTES_MAX; i++) {
+        notes += host_playing[i] != 0.0f;
+    }
+    return notes;
+}
+
+// Boot
+
+void host_boot(void) {
+    host_clock = 1000;
+    memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+    debounce_init(MATRIX_ROWS);
+    default_layer_state_set(1);
+    keyboard_post_init_user();
+    notify_usb_device_state_change_user(USB_DEVICE_STATE_CONFIGURED);
+}
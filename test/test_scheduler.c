@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Checks the scheduler on its own: run order, moving and cancelling a
+ * pending callback, a full heap, rescheduling by return value and due
+ * times that wrap.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "scheduler.h"
+
+static int failures;
+
+#define EXPECT(condition) expect_true(__LINE__, #condition, condition)
+
+static void expect_true(int line, const char *condition, bool value) {
+    if (!value) {
+        fprintf(stderr, "    test_scheduler.c:%d: %s\n", line, condition);
+        failures++;
+    }
+}
+
+// Each callback appends its letter to the log and returns its delay.
+
+static char     log_text[64];
+static uint32_t log_delay[12];
+
+static uint32_t log_run(int which) {
+    size_t length = strlen(log_text);
+    if (length + 1 < sizeof(log_text)) {
+        log_text[length]     = 'a' + which;
+        log_text[length + 1] = '\0';
+    }
+    return log_delay[which];
+}
+
+#define CALLBACK(n) \
+    static uint32_t callback_##n(uint32_t now, void *arg) { return log_run(n); }
+CALLBACK(0)
+CALLBACK(1)
+CALLBACK(2)
+CALLBACK(3)
+CALLBACK(4)
+CALLBACK(5)
+CALLBACK(6)
+CALLBACK(7)
+CALLBACK(8)
+CALLBACK(9)
+CALLBACK(10)
+CALLBACK(11)
+
+static const scheduler_callback_t callbacks[] = {
+    callback_0, callback_1, callback_2, callback_3, callback_4,  callback_5,
+    callback_6, callback_7, callback_8, callback_9, callback_10, callback_11,
+};
+
+_Static_assert(SCHEDULER_CAPACITY < sizeof(callbacks) / sizeof(callbacks[0]), "need more callbacks than the heap holds");
+
+static void reset(void) {
+    for (unsigned i = 0; i < sizeof(callbacks) / sizeof(callbacks[0]); i++) {
+        scheduler_cancel(callbacks[i]);
+        log_delay[i] = 0;
+    }
+    log_text[0] = '\0';
+}
+
+static void run_order(void) {
+    scheduler_add(100, 30, callback_0, NULL);
+    scheduler_add(100, 10, callback_1, NULL);
+    scheduler_add(100, 20, callback_2, NULL);
+    scheduler_run(109);
+    EXPECT(!strcmp(log_text, ""));
+    scheduler_run(125);
+    EXPECT(!strcmp(log_text, "bc"));
+    scheduler_run(130);
+    EXPECT(!strcmp(log_text, "bca"));
+    EXPECT(!scheduler_pending(callback_0));
+}
+
+static void add_moves_pending(void) {
+    scheduler_add(0, 10, callback_0, NULL);
+    scheduler_add(0, 20, callback_1, NULL);
+    scheduler_add(0, 30, callback_0, NULL);
+    scheduler_run(30);
+    EXPECT(!strcmp(log_text, "ba"));
+}
+
+static void cancel(void) {
+    scheduler_add(0, 10, callback_0, NULL);
+    scheduler_add(0, 10, callback_1, NULL);
+    scheduler_cancel(callback_0);
+    EXPECT(!scheduler_pending(callback_0));
+    EXPECT(scheduler_pending(callback_1));
+    scheduler_run(10);
+    EXPECT(!strcmp(log_text, "b"));
+}
+
+static void full_heap(void) {
+    for (int i = 0; i < SCHEDULER_CAPACITY; i++) {
+        EXPECT(scheduler_add(0, 10, callbacks[i], NULL));
+    }
+    EXPECT(!scheduler_add(0, 10, callbacks[SCHEDULER_CAPACITY], NULL));
+    EXPECT(!scheduler_pending(callbacks[SCHEDULER_CAPACITY]));
+    // Moving one already in the heap needs no room.
+    EXPECT(scheduler_add(0, 5, callbacks[0], NULL));
+    scheduler_run(5);
+    EXPECT(!strcmp(log_text, "a"));
+    EXPECT(scheduler_add(0, 10, callbacks[SCHEDULER_CAPACITY], NULL));
+}
+
+static void reschedule(void) {
+    log_delay[0] = 15;
+    scheduler_add(0, 10, callback_0, NULL);
+    scheduler_run(10);
+    EXPECT(!strcmp(log_text, "a"));
+    scheduler_run(24);
+    EXPECT(!strcmp(log_text, "a"));
+    log_delay[0] = 0;
+    scheduler_run(25);
+    EXPECT(!strcmp(log_text, "aa"));
+    EXPECT(!scheduler_pending(callback_0));
+}
+
+static void wraparound(void) {
+    uint32_t now = UINT32_MAX - 5;
+    scheduler_add(now, 20, callback_0, NULL);
+    scheduler_add(now, 2, callback_1, NULL);
+    scheduler_run(now + 2);
+    EXPECT(!strcmp(log_text, "b"));
+    scheduler_run(now + 19);
+    EXPECT(!strcmp(log_text, "b"));
+    scheduler_run(now + 20);
+    EXPECT(!strcmp(log_text, "ba"));
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} tests[] = {
+    {"run_order", run_order},   {"add_moves_pending", add_moves_pending},
+    {"cancel", cancel},         {"full_heap", full_heap},
+    {"reschedule", reschedule}, {"wraparound", wraparound},
+};
+
+int main(void) {
+    unsigned count = sizeof(tests) / sizeof(tests[0]), failed = 0;
+    for (unsigned i = 0; i < count; i++) {
+        reset();
+        int before = failures;
+        tests[i].run();
+        if (failures != before) {
+            fprintf(stderr, "FAIL %s\n", tests[i].name);
+            failed++;
+        }
+    }
+    printf("%u of %u scheduler tests passed\n", count - failed, count);
+    return failed != 0;
+}